@@ -0,0 +1,445 @@
+// Build: g++ -std=c++20 -O2 -march=native -pthread -I../../../../static/code capture_writer.cpp
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lockfree/queue.h"
+#include "market_data_parser.h"
+
+/**
+ * Normalized columnar capture of parsed quotes and trades.
+ *
+ * Every field of every message type goes to its own file
+ * (`<dir>/quote.bidPrice.col`, `<dir>/trade.volume.col`, ...), so a scan over
+ * one field reads only that field's bytes. A column file is a small header
+ * followed by independent blocks of up to `BlockRows` values:
+ *   file:  "PCOL" | u8 encoding
+ *   block: u32 rows | u32 bytes | `bytes` of LEB128 varints
+ * Encodings:
+ * - Varint: the value as is (symbol indices, volumes),
+ * - Delta: zigzag of the difference to the previous value in the block
+ *   (timestamps, sequence numbers, trade IDs, prices). Prices are stored as
+ *   integer ticks of 1/PriceScale, which is exact for Pillar's 4-decimal
+ *   prices; a price off that grid is stored rounded and counted.
+ * Deltas restart at every block, so a reader can skip or split blocks.
+ *
+ * The parser thread only copies each message into an SPSC ring; encoding and
+ * file I/O happen on a background writer thread. A failed write stops that
+ * column and is reported by `close`, rather than leaving a silently short
+ * file.
+ */
+
+constexpr double PriceScale = 10000.0;
+constexpr uint32_t BlockRows = 65536;
+
+enum class Encoding : uint8_t { Varint = 0, Delta = 1 };
+
+inline uint64_t zigzag(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t unzigzag(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+inline void putVarint(std::vector<uint8_t> &out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value) | 0x80);
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+/// Returns false if the varint runs past `end` or beyond 64 bits.
+inline bool getVarint(const uint8_t *&in, const uint8_t *end, uint64_t &value) {
+  value = 0;
+  for (int shift = 0; shift < 64 && in != end; shift += 7) {
+    uint8_t byte = *in++;
+    value |= uint64_t(byte & 0x7f) << shift;
+    if (byte < 0x80)
+      return true;
+  }
+  return false;
+}
+
+inline int64_t toTicks(double price) { return std::llround(price * PriceScale); }
+
+/// Whether `price` is a whole number of ticks, allowing for the rounding
+/// error that arithmetic on 4-decimal prices accumulates.
+inline bool onTick(double price) {
+  return std::fabs(price * PriceScale - static_cast<double>(toTicks(price))) < 1e-3;
+}
+
+class ColumnWriter {
+public:
+  ColumnWriter(const std::filesystem::path &path, Encoding encoding)
+      : path(path), encoding(encoding) {
+    file = std::fopen(path.c_str(), "wb");
+    if (!file)
+      throw std::runtime_error("cannot create " + path.string());
+    if (std::fwrite("PCOL", 1, 4, file) != 4 ||
+        std::fputc(static_cast<int>(encoding), file) == EOF)
+      failed = true;
+    block.reserve(BlockRows * 3);
+  }
+
+  ~ColumnWriter() { close(); }
+
+  ColumnWriter(const ColumnWriter &) = delete;
+  ColumnWriter &operator=(const ColumnWriter &) = delete;
+
+  void append(int64_t value) {
+    if (encoding == Encoding::Delta) {
+      putVarint(block, zigzag(value - previous));
+      previous = value;
+    } else {
+      putVarint(block, static_cast<uint64_t>(value));
+    }
+    if (++rows == BlockRows)
+      flushBlock();
+  }
+
+  /// Writes the last partial block and closes the file; once only.
+  void close() {
+    if (!file)
+      return;
+    flushBlock();
+    if (std::fflush(file) != 0)
+      failed = true;
+    if (std::fclose(file) != 0)
+      failed = true;
+    file = nullptr;
+  }
+
+  /// Whether any write failed; the file then ends at the last whole block.
+  bool failedWrite() const { return failed; }
+  const std::filesystem::path &filePath() const { return path; }
+  uint64_t bytesWritten() const { return written; }
+
+private:
+  void flushBlock() {
+    if (rows == 0)
+      return;
+    uint32_t bytes = static_cast<uint32_t>(block.size());
+    if (!failed) {
+      failed = std::fwrite(&rows, sizeof(rows), 1, file) != 1 ||
+               std::fwrite(&bytes, sizeof(bytes), 1, file) != 1 ||
+               std::fwrite(block.data(), 1, block.size(), file) != block.size();
+      if (!failed)
+        written += sizeof(rows) + sizeof(bytes) + block.size();
+    }
+    block.clear();
+    rows = 0;
+    previous = 0;
+  }
+
+  std::filesystem::path path;
+  std::FILE *file;
+  Encoding encoding;
+  bool failed = false;
+  std::vector<uint8_t> block;
+  uint32_t rows = 0;
+  int64_t previous = 0;
+  uint64_t written = 5;
+};
+
+/// Calls `visit(int64_t)` for every value of a column file; returns bytes read.
+/// A truncated final block ends the scan; a block whose varints do not
+/// decode to `rows` values throws.
+template <typename Visit>
+uint64_t scanColumn(const std::filesystem::path &path, Visit visit) {
+  std::FILE *file = std::fopen(path.c_str(), "rb");
+  if (!file)
+    throw std::runtime_error("cannot open " + path.string());
+  char magic[4];
+  int encoding = 0;
+  if (std::fread(magic, 1, 4, file) != 4 || std::memcmp(magic, "PCOL", 4) != 0 ||
+      (encoding = std::fgetc(file)) == EOF) {
+    std::fclose(file);
+    throw std::runtime_error(path.string() + " is not a column file");
+  }
+
+  uint64_t bytesRead = 5;
+  std::vector<uint8_t> block;
+  uint32_t rows;
+  uint32_t bytes;
+  while (std::fread(&rows, sizeof(rows), 1, file) == 1 &&
+         std::fread(&bytes, sizeof(bytes), 1, file) == 1) {
+    block.resize(bytes);
+    if (std::fread(block.data(), 1, bytes, file) != bytes)
+      break; // truncated final block, e.g. the writer was killed
+    bytesRead += sizeof(rows) + sizeof(bytes) + bytes;
+
+    const uint8_t *in = block.data();
+    const uint8_t *end = in + bytes;
+    int64_t value = 0;
+    for (uint32_t row = 0; row < rows; ++row) {
+      uint64_t raw;
+      if (!getVarint(in, end, raw)) {
+        std::fclose(file);
+        throw std::runtime_error(path.string() + ": corrupt block at byte " +
+                                 std::to_string(bytesRead - bytes));
+      }
+      if (encoding == static_cast<int>(Encoding::Delta))
+        value += unzigzag(raw);
+      else
+        value = static_cast<int64_t>(raw);
+      visit(value);
+    }
+  }
+  std::fclose(file);
+  return bytesRead;
+}
+
+struct QuoteColumnFiles {
+  explicit QuoteColumnFiles(const std::filesystem::path &dir)
+      : sourceTime(dir / "quote.sourceTime.col", Encoding::Delta),
+        symbolIndex(dir / "quote.symbolIndex.col", Encoding::Varint),
+        symbolSeqNum(dir / "quote.symbolSeqNum.col", Encoding::Delta),
+        askPrice(dir / "quote.askPrice.col", Encoding::Delta),
+        askVolume(dir / "quote.askVolume.col", Encoding::Varint),
+        bidPrice(dir / "quote.bidPrice.col", Encoding::Delta),
+        bidVolume(dir / "quote.bidVolume.col", Encoding::Varint) {}
+
+  void append(const Header &header, const QuoteMessage &quote) {
+    sourceTime.append(header.sourceTime);
+    symbolIndex.append(quote.symbolIndex);
+    symbolSeqNum.append(quote.symbolSeqNum);
+    askPrice.append(toTicks(quote.askPrice));
+    askVolume.append(quote.askVolume);
+    bidPrice.append(toTicks(quote.bidPrice));
+    bidVolume.append(quote.bidVolume);
+    offTickPrices += !onTick(quote.askPrice) + !onTick(quote.bidPrice);
+  }
+
+  ColumnWriter sourceTime, symbolIndex, symbolSeqNum, askPrice, askVolume, bidPrice, bidVolume;
+  ColumnWriter *columns[7] = {&sourceTime, &symbolIndex, &symbolSeqNum, &askPrice,
+                              &askVolume,  &bidPrice,    &bidVolume};
+  uint64_t offTickPrices = 0;
+};
+
+struct TradeColumnFiles {
+  explicit TradeColumnFiles(const std::filesystem::path &dir)
+      : sourceTime(dir / "trade.sourceTime.col", Encoding::Delta),
+        symbolIndex(dir / "trade.symbolIndex.col", Encoding::Varint),
+        symbolSeqNum(dir / "trade.symbolSeqNum.col", Encoding::Delta),
+        tradeID(dir / "trade.tradeID.col", Encoding::Delta),
+        price(dir / "trade.price.col", Encoding::Delta),
+        volume(dir / "trade.volume.col", Encoding::Varint) {}
+
+  void append(const Header &header, const TradeMessage &trade) {
+    sourceTime.append(header.sourceTime);
+    symbolIndex.append(trade.symbolIndex);
+    symbolSeqNum.append(trade.symbolSeqNum);
+    tradeID.append(trade.tradeID);
+    price.append(toTicks(trade.price));
+    volume.append(trade.volume);
+    offTickPrices += !onTick(trade.price);
+  }
+
+  ColumnWriter sourceTime, symbolIndex, symbolSeqNum, tradeID, price, volume;
+  ColumnWriter *columns[6] = {&sourceTime, &symbolIndex, &symbolSeqNum,
+                              &tradeID,    &price,       &volume};
+  uint64_t offTickPrices = 0;
+};
+
+/**
+ * MarketDataParser handler that hands quotes and trades to the writer thread.
+ * Capture must be complete, so a full ring blocks the parser rather than
+ * dropping; size the ring to absorb the writer's I/O stalls.
+ */
+class ColumnCaptureWriter {
+public:
+  explicit ColumnCaptureWriter(const std::filesystem::path &dir)
+      : ring(std::make_unique<Ring>()), quotes(dir), trades(dir),
+        writer([this] { drain(); }) {}
+
+  ~ColumnCaptureWriter() { finish(); }
+
+  ColumnCaptureWriter(const ColumnCaptureWriter &) = delete;
+  ColumnCaptureWriter &operator=(const ColumnCaptureWriter &) = delete;
+
+  void onQuote(const Header &header, const QuoteMessage &quote) {
+    Record record{header, {}};
+    record.quote = quote;
+    push(record);
+  }
+
+  void onTrade(const Header &header, const TradeMessage &trade) {
+    Record record{header, {}};
+    record.trade = trade;
+    push(record);
+  }
+
+  void onStockSummary(const Header &, const StockSummary &) {}
+
+  /// Drains the ring, flushes the last partial block of every column and
+  /// closes the files; throws std::runtime_error naming a column that
+  /// failed to write.
+  void close() {
+    finish();
+    for (ColumnWriter *column : quotes.columns)
+      check(*column);
+    for (ColumnWriter *column : trades.columns)
+      check(*column);
+  }
+
+  uint64_t stalls() const { return fullRing; }
+
+  /// Prices stored rounded to the tick grid; read after `close`.
+  uint64_t offTickPrices() const { return quotes.offTickPrices + trades.offTickPrices; }
+
+private:
+  struct Record {
+    Header header;
+    union {
+      QuoteMessage quote;
+      TradeMessage trade;
+    };
+  };
+  using Ring = LockFreeQueue<Record, 16384>;
+
+  void finish() {
+    if (!writer.joinable())
+      return;
+    done.store(true, std::memory_order_release);
+    writer.join();
+    for (ColumnWriter *column : quotes.columns)
+      column->close();
+    for (ColumnWriter *column : trades.columns)
+      column->close();
+  }
+
+  static void check(const ColumnWriter &column) {
+    if (column.failedWrite())
+      throw std::runtime_error("cannot write " + column.filePath().string());
+  }
+
+  void push(const Record &record) {
+    while (!ring->enqueue(record)) {
+      ++fullRing;
+      std::this_thread::yield();
+    }
+  }
+
+  void drain() {
+    // Records are taken in bursts: one handoff of the ring's head per burst
+    // instead of one per record.
+    std::array<Record, 256> batch;
+    for (;;) {
+      // `done` is set after the last push, so once it is seen an empty ring
+      // stays empty.
+      bool finished = done.load(std::memory_order_acquire);
+      size_t count = ring->dequeue_bulk(batch);
+      for (size_t i = 0; i < count; ++i)
+        write(batch[i]);
+      if (count == 0) {
+        if (finished)
+          return;
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  void write(const Record &record) {
+    if (record.header.msgType == static_cast<uint16_t>(MsgType::Quote))
+      quotes.append(record.header, record.quote);
+    else
+      trades.append(record.header, record.trade);
+  }
+
+  std::unique_ptr<Ring> ring;
+  QuoteColumnFiles quotes;
+  TradeColumnFiles trades;
+  std::atomic<bool> done{false};
+  uint64_t fullRing = 0;
+  std::thread writer; // last: starts once the columns are open
+};
+
+int main(int argc, char **argv) {
+  std::filesystem::path dir =
+      argc > 1 ? std::filesystem::path(argv[1])
+               : std::filesystem::temp_directory_path() / "pillar_capture";
+  std::filesystem::create_directories(dir);
+
+  // A session-like stream: 4M messages, 80% quotes, over 5000 symbols with
+  // prices walking a cent at a time.
+  constexpr size_t messageCount = 4000000;
+  constexpr size_t symbolCount = 5000;
+  std::mt19937 rng(11);
+  std::vector<double> mid(symbolCount);
+  for (double &m : mid)
+    m = 10.0 + rng() % 40000 / 100.0;
+  std::vector<uint32_t> seq(symbolCount, 0);
+  auto lots = [&](uint32_t max) { return 100 * (1 + static_cast<uint32_t>(rng() % max)); };
+
+  std::vector<uint8_t> stream;
+  stream.reserve(messageCount * (sizeof(Header) + sizeof(QuoteMessage)));
+  double bidTicksSent = 0;
+  for (uint32_t m = 0; m < messageCount; ++m) {
+    uint32_t symbol = (rng() % 4) ? rng() % 200 : rng() % symbolCount;
+    mid[symbol] = std::max(0.05, mid[symbol] + ((int)(rng() % 3) - 1) / 100.0);
+    uint32_t sourceTime = static_cast<uint32_t>(uint64_t(m) * 1500);
+    if (rng() % 5) {
+      QuoteMessage quote{symbol, ++seq[symbol], mid[symbol] + 0.01, lots(20),
+                         mid[symbol] - 0.01, lots(20)};
+      bidTicksSent += toTicks(quote.bidPrice);
+      encodeMessage(stream, MsgType::Quote, sourceTime, quote);
+    } else {
+      TradeMessage trade{symbol, ++seq[symbol], m, mid[symbol], lots(10)};
+      encodeMessage(stream, MsgType::Trade, sourceTime, trade);
+    }
+  }
+  // One quote priced between ticks, which is stored rounded and counted.
+  QuoteMessage subTick{0, ++seq[0], 10.00015, 100, 10.00005, 100};
+  bidTicksSent += toTicks(subTick.bidPrice);
+  encodeMessage(stream, MsgType::Quote, static_cast<uint32_t>(messageCount * 1500), subTick);
+
+  auto start = std::chrono::steady_clock::now();
+  uint64_t stalls = 0;
+  uint64_t offTick = 0;
+  {
+    ColumnCaptureWriter capture(dir);
+    MarketDataParser<ColumnCaptureWriter> parser(capture);
+    parser.parse(stream);
+    capture.close();
+    stalls = capture.stalls();
+    offTick = capture.offTickPrices();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  uint64_t columnBytes = 0;
+  for (const auto &entry : std::filesystem::directory_iterator(dir))
+    if (entry.path().extension() == ".col")
+      columnBytes += entry.file_size();
+  std::printf("captured %zu messages in %.3f s (%.1f ns/msg, %llu ring stalls) to %s\n",
+              messageCount, elapsed.count(), elapsed.count() * 1e9 / messageCount,
+              static_cast<unsigned long long>(stalls), dir.c_str());
+  std::printf("raw Pillar bytes: %zu, all columns: %llu (%.1f%%), off-tick prices rounded: %llu\n",
+              stream.size(), static_cast<unsigned long long>(columnBytes),
+              100.0 * columnBytes / stream.size(), static_cast<unsigned long long>(offTick));
+
+  // The analytics case: every bid price of the session.
+  double bidTicksRead = 0;
+  uint64_t bids = 0;
+  uint64_t scanned = scanColumn(dir / "quote.bidPrice.col", [&](int64_t ticks) {
+    bidTicksRead += ticks;
+    ++bids;
+  });
+  std::printf("scan of quote.bidPrice: %llu values from %llu bytes (%.1f%% of raw), "
+              "round trip %s\n",
+              static_cast<unsigned long long>(bids), static_cast<unsigned long long>(scanned),
+              100.0 * scanned / stream.size(), bidTicksRead == bidTicksSent ? "exact" : "MISMATCH");
+  return 0;
+}
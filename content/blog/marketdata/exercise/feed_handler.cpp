@@ -0,0 +1,425 @@
+// Build: g++ -std=c++20 -O2 -march=native -pthread -I../../../../static/code feed_handler.cpp
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "lockfree/queue.h"
+#include "market_data_parser.h"
+
+/**
+ * Multi-stream feed handler with A/B line arbitration.
+ *
+ * The exchange publishes every stream twice, on line A and line B. Each line
+ * gets its own thread running its own `MarketDataParser`, so a slow or
+ * jittery line never stalls the other one. Parsed messages go through one
+ * SPSC `LockFreeQueue` per line into a single arbiter thread that:
+ * - forwards the first copy of every (symbolIndex, symbolSeqNum) it sees,
+ *   whichever line delivered it,
+ * - drops the later copy as a duplicate,
+ * - emits one merged stream in symbolSeqNum order per symbol.
+ *
+ * No locks anywhere: every queue has exactly one producer and one consumer,
+ * and the per-symbol sequence table is owned by the arbiter thread alone.
+ */
+
+enum class Line : uint8_t { A = 0, B = 1 };
+
+struct FeedEvent {
+  Header header;
+  Line line;
+  union {
+    QuoteMessage quote;
+    TradeMessage trade;
+    StockSummary summary;
+  };
+};
+
+constexpr size_t LineQueueSize = 4096;
+using LineQueue = LockFreeQueue<FeedEvent, LineQueueSize>;
+
+/**
+ * Parser handler for one line: builds each message's FeedEvent directly in
+ * the next slot of the line's queue (try_claim/commit), so the event is
+ * never copied on the way in. If the arbiter falls behind, it yields
+ * instead of spinning, so a full queue never keeps the arbiter (or the other
+ * line) off a shared core long enough for a held gap to time out.
+ */
+class LinePublisher {
+public:
+  LinePublisher(LineQueue &queue, Line line) : queue(queue), line(line) {}
+
+  void onQuote(const Header &header, const QuoteMessage &quote) {
+    claim(header).quote = quote;
+    queue.commit();
+  }
+
+  void onTrade(const Header &header, const TradeMessage &trade) {
+    claim(header).trade = trade;
+    queue.commit();
+  }
+
+  void onStockSummary(const Header &header, const StockSummary &summary) {
+    claim(header).summary = summary;
+    queue.commit();
+  }
+
+private:
+  FeedEvent &claim(const Header &header) {
+    FeedEvent *event;
+    while ((event = queue.try_claim()) == nullptr)
+      std::this_thread::yield();
+    event->header = header;
+    event->line = line;
+    return *event;
+  }
+
+  LineQueue &queue;
+  Line line;
+};
+
+struct ArbiterStats {
+  uint64_t forwarded = 0;
+  uint64_t duplicates = 0;
+  uint64_t gaps = 0; // forwarded events that skipped one or more seq numbers
+  uint64_t unknownSymbols = 0; // dropped: symbolIndex beyond the table
+  uint64_t wonBy[2] = {0, 0};
+};
+
+enum class Verdict { Duplicate, InOrder, Gap, UnknownSymbol };
+
+/**
+ * Per-symbol sequencing state shared by all lines.
+ * - Quotes and trades are arbitrated on symbolSeqNum: the next seq number
+ *   for a symbol is in order, anything at or below the last forwarded one is
+ *   a duplicate, anything beyond it is a gap. The first seq number seen for
+ *   a symbol is in order, so a handler joining mid-session does not hold
+ *   and count a false gap for every symbol.
+ * - Stock summaries carry no seq number, so they are arbitrated on
+ *   sourceTime and never report a gap. sourceTime is 32 bits of
+ *   nanoseconds and wraps every ~4.3 s, so times are compared by signed
+ *   difference, which is right as long as summaries for one symbol are
+ *   less than ~2.1 s apart.
+ * - Symbol state is a dense table indexed by symbolIndex; a message for a
+ *   symbol beyond it is dropped and counted, never indexed.
+ */
+template <typename Sink>
+class LineArbiter {
+public:
+  LineArbiter(Sink &sink, size_t symbolCount)
+      : sink(sink), lastSeq(symbolCount), lastSummary(symbolCount) {}
+
+  Verdict classify(const FeedEvent &event) const {
+    switch (static_cast<MsgType>(event.header.msgType)) {
+    case MsgType::Quote:
+      return classify(event.quote.symbolIndex, event.quote.symbolSeqNum);
+    case MsgType::Trade:
+      return classify(event.trade.symbolIndex, event.trade.symbolSeqNum);
+    case MsgType::StockSummary: {
+      if (event.summary.symbolIndex >= lastSummary.size())
+        return Verdict::UnknownSymbol;
+      const SummaryTime &last = lastSummary[event.summary.symbolIndex];
+      int32_t step = static_cast<int32_t>(event.header.sourceTime - last.time);
+      return last.seen && step <= 0 ? Verdict::Duplicate : Verdict::InOrder;
+    }
+    }
+    return Verdict::Duplicate;
+  }
+
+  void forward(const FeedEvent &event, Verdict verdict) {
+    switch (static_cast<MsgType>(event.header.msgType)) {
+    case MsgType::Quote:
+      lastSeq[event.quote.symbolIndex] = {event.quote.symbolSeqNum, true};
+      break;
+    case MsgType::Trade:
+      lastSeq[event.trade.symbolIndex] = {event.trade.symbolSeqNum, true};
+      break;
+    case MsgType::StockSummary:
+      lastSummary[event.summary.symbolIndex] = {event.header.sourceTime, true};
+      break;
+    }
+    if (verdict == Verdict::Gap)
+      ++stats_.gaps;
+    ++stats_.forwarded;
+    ++stats_.wonBy[static_cast<size_t>(event.line)];
+    sink.onEvent(event);
+  }
+
+  void drop() { ++stats_.duplicates; }
+
+  void dropUnknown() { ++stats_.unknownSymbols; }
+
+  const ArbiterStats &stats() const { return stats_; }
+
+private:
+  struct SymbolSeq {
+    uint32_t seq = 0;
+    bool seen = false;
+  };
+
+  struct SummaryTime {
+    uint32_t time = 0;
+    bool seen = false;
+  };
+
+  Verdict classify(uint32_t symbolIndex, uint32_t seq) const {
+    if (symbolIndex >= lastSeq.size())
+      return Verdict::UnknownSymbol;
+    const SymbolSeq &last = lastSeq[symbolIndex];
+    if (!last.seen)
+      return Verdict::InOrder;
+    if (seq <= last.seq)
+      return Verdict::Duplicate;
+    return seq == last.seq + 1 ? Verdict::InOrder : Verdict::Gap;
+  }
+
+  Sink &sink;
+  std::vector<SymbolSeq> lastSeq;
+  std::vector<SummaryTime> lastSummary;
+  ArbiterStats stats_;
+};
+
+/**
+ * Owns one parser thread per line per stream and the arbiter thread.
+ *
+ * In-order events are forwarded the moment either line delivers them. An
+ * event that would open a gap is held at the head of its line for up to
+ * `gapTimeout`, since the other line usually still carries the missing
+ * message; the gap is accepted once the timeout expires, the other line is
+ * also stuck on a gap, or every line has been drained.
+ *
+ * `run` blocks until every line has delivered its packets and the arbiter
+ * has drained all queues.
+ */
+template <typename Sink>
+class FeedHandler {
+public:
+  using Packets = std::vector<std::vector<uint8_t>>;
+  using Clock = std::chrono::steady_clock;
+
+  FeedHandler(Sink &sink, size_t streamCount, size_t symbolCount,
+              std::chrono::microseconds gapTimeout = std::chrono::microseconds(200))
+      : arbiter(sink, symbolCount), queues(streamCount * 2),
+        lines(streamCount * 2), gapTimeout(gapTimeout) {}
+
+  /// `packets[stream][line]` is the packet sequence that line will deliver.
+  void run(const std::vector<std::array<Packets, 2>> &packets) {
+    std::vector<std::thread> threads;
+    for (size_t stream = 0; stream < packets.size(); ++stream) {
+      for (size_t line = 0; line < 2; ++line) {
+        threads.emplace_back([this, &packets, stream, line] {
+          runLine(packets[stream][line], queues[stream * 2 + line],
+                  static_cast<Line>(line), stream * 2 + line);
+        });
+      }
+    }
+
+    std::thread arbiterThread([this] { runArbiter(); });
+    for (std::thread &thread : threads)
+      thread.join();
+    linesDone.store(true, std::memory_order_release);
+    arbiterThread.join();
+  }
+
+  const ArbiterStats &stats() const { return arbiter.stats(); }
+
+private:
+  /// A held event stays at the head of its queue until it is decided.
+  struct LineState {
+    bool held = false;
+    Clock::time_point heldSince;
+  };
+
+  void runLine(const Packets &packets, LineQueue &queue, Line line,
+               size_t seed) {
+    LinePublisher publisher(queue, line);
+    MarketDataParser<LinePublisher> parser(publisher);
+
+    // Network jitter: each line stalls at random, independently of the other.
+    std::mt19937 rng(static_cast<uint32_t>(seed));
+    std::uniform_int_distribution<int> jitter(0, 99);
+    for (const std::vector<uint8_t> &packet : packets) {
+      if (jitter(rng) < 5)
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+      parser.parse(packet);
+    }
+  }
+
+  void runArbiter() {
+    bool flushGaps = false;
+    for (;;) {
+      bool done = linesDone.load(std::memory_order_acquire);
+      bool idle = true;
+      for (size_t index = 0; index < lines.size(); ++index)
+        idle &= !drainLine(index, flushGaps);
+      if (!done || !idle) {
+        flushGaps = false;
+        continue;
+      }
+      // Producers finished and every queue is drained: whatever is still
+      // held is a real gap on both lines.
+      if (flushGaps)
+        return;
+      flushGaps = true;
+    }
+  }
+
+  /// Returns true if any event of the line was consumed.
+  bool drainLine(size_t index, bool flushGaps) {
+    LineState &state = lines[index];
+    bool progress = false;
+
+    // Events are classified and forwarded in place, straight out of the
+    // queue slot (try_peek/release).
+    for (;;) {
+      const FeedEvent *event = queues[index].try_peek();
+      if (event == nullptr)
+        return progress;
+
+      Verdict verdict = arbiter.classify(*event);
+      if (verdict == Verdict::Gap) {
+        if (!state.held) {
+          state.held = true;
+          state.heldSince = Clock::now();
+          return progress;
+        }
+        if (!flushGaps && !otherStuck(index) &&
+            Clock::now() - state.heldSince < gapTimeout)
+          return progress;
+      }
+
+      state.held = false;
+      progress = true;
+      if (verdict == Verdict::Duplicate)
+        arbiter.drop();
+      else if (verdict == Verdict::UnknownSymbol)
+        arbiter.dropUnknown();
+      else
+        arbiter.forward(*event, verdict);
+      queues[index].release();
+    }
+  }
+
+  bool otherStuck(size_t index) {
+    size_t other = index ^ 1;
+    if (!lines[other].held)
+      return false;
+    const FeedEvent *event = queues[other].try_peek();
+    return event != nullptr && arbiter.classify(*event) == Verdict::Gap;
+  }
+
+  LineArbiter<Sink> arbiter;
+  std::vector<LineQueue> queues;
+  std::vector<LineState> lines; // indexed like `queues`: stream * 2 + line
+  std::chrono::microseconds gapTimeout;
+  std::atomic<bool> linesDone{false};
+};
+
+/**
+ * Checks the merged stream: every symbol must come out in strictly
+ * increasing symbolSeqNum order.
+ */
+struct OrderCheckingSink {
+  explicit OrderCheckingSink(size_t symbolCount) : lastSeq(symbolCount, 0) {}
+
+  void onEvent(const FeedEvent &event) {
+    uint32_t symbolIndex = 0;
+    uint32_t seq = 0;
+    if (event.header.msgType == static_cast<uint16_t>(MsgType::Quote)) {
+      symbolIndex = event.quote.symbolIndex;
+      seq = event.quote.symbolSeqNum;
+    } else if (event.header.msgType == static_cast<uint16_t>(MsgType::Trade)) {
+      symbolIndex = event.trade.symbolIndex;
+      seq = event.trade.symbolSeqNum;
+    } else {
+      return;
+    }
+    if (seq <= lastSeq[symbolIndex])
+      ++outOfOrder;
+    lastSeq[symbolIndex] = seq;
+  }
+
+  std::vector<uint32_t> lastSeq;
+  uint64_t outOfOrder = 0;
+};
+
+int main() {
+  constexpr size_t streamCount = 4;
+  constexpr size_t symbolsPerStream = 64;
+  constexpr size_t symbolCount = streamCount * symbolsPerStream;
+  constexpr size_t packetsPerStream = 20000;
+  constexpr size_t messagesPerPacket = 4;
+
+  // Each stream carries its own symbol range. Both lines get the same
+  // packets; each line independently loses ~1% of them, so neither line
+  // alone is complete but the arbitrated merge is.
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> loss(0, 99);
+  std::vector<std::array<FeedHandler<OrderCheckingSink>::Packets, 2>> packets(
+      streamCount);
+  std::vector<uint32_t> seq(symbolCount, 0);
+  uint32_t sourceTime = 0;
+  uint32_t tradeID = 0;
+
+  for (size_t stream = 0; stream < streamCount; ++stream) {
+    for (size_t p = 0; p < packetsPerStream; ++p) {
+      std::vector<uint8_t> packet;
+      for (size_t m = 0; m < messagesPerPacket; ++m) {
+        uint32_t symbolIndex = static_cast<uint32_t>(
+            stream * symbolsPerStream + rng() % symbolsPerStream);
+        if (rng() % 4 == 0) {
+          TradeMessage trade{symbolIndex, ++seq[symbolIndex], ++tradeID,
+                             100.0 + symbolIndex, 100};
+          encodeMessage(packet, MsgType::Trade, ++sourceTime, trade);
+        } else {
+          QuoteMessage quote{symbolIndex, ++seq[symbolIndex], 100.01, 200,
+                             99.99, 300};
+          encodeMessage(packet, MsgType::Quote, ++sourceTime, quote);
+        }
+      }
+      bool lostOnA = loss(rng) == 0;
+      bool lostOnB = !lostOnA && loss(rng) == 0;
+      if (!lostOnA)
+        packets[stream][0].push_back(packet);
+      if (!lostOnB)
+        packets[stream][1].push_back(packet);
+    }
+    // A well-formed quote for a symbol outside the table (problem.md's
+    // sample index) must be dropped, on both lines.
+    std::vector<uint8_t> stray;
+    encodeMessage(stray, MsgType::Quote, ++sourceTime,
+                  QuoteMessage{0x12345678, 1, 100.01, 200, 99.99, 300});
+    packets[stream][0].push_back(stray);
+    packets[stream][1].push_back(stray);
+  }
+
+  OrderCheckingSink sink(symbolCount);
+  // Line threads here share cores with each other, so one line can trail
+  // the other by a scheduler quantum; allow for that before declaring a gap.
+  FeedHandler<OrderCheckingSink> handler(sink, streamCount, symbolCount,
+                                         std::chrono::milliseconds(20));
+
+  auto start = std::chrono::steady_clock::now();
+  handler.run(packets);
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+
+  const ArbiterStats &stats = handler.stats();
+  std::printf("forwarded: %llu (A: %llu, B: %llu), duplicates: %llu, "
+              "gaps: %llu, unknown symbols: %llu, out of order: %llu\n",
+              static_cast<unsigned long long>(stats.forwarded),
+              static_cast<unsigned long long>(stats.wonBy[0]),
+              static_cast<unsigned long long>(stats.wonBy[1]),
+              static_cast<unsigned long long>(stats.duplicates),
+              static_cast<unsigned long long>(stats.gaps),
+              static_cast<unsigned long long>(stats.unknownSymbols),
+              static_cast<unsigned long long>(sink.outOfOrder));
+  std::printf("expected: %zu messages, %zu unknown, elapsed: %lld us\n",
+              streamCount * packetsPerStream * messagesPerPacket, 2 * streamCount,
+              static_cast<long long>(elapsed.count()));
+  return 0;
+}
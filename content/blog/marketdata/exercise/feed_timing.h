@@ -0,0 +1,186 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+
+#include "../../../../static/code/lockfree/tsc.h"
+
+/**
+ * Timestamp normalization and latency tagging for the feed parser.
+ *
+ * - `readTsc` is the receive stamp: one instruction, no syscall. TSC ticks
+ *   are converted to nanoseconds with a ratio calibrated once per process
+ *   against steady_clock (the TSC is invariant on every host we run on).
+ *   Both come from lockfree/tsc.h, shared with the queue benchmarks.
+ * - `SourceClock` extends the 32-bit, wrapping Header::sourceTime (~4.3 s
+ *   range) to 64-bit nanoseconds, one instance per stream.
+ * - `LatencyHistogram` is an HDR-style log-linear histogram of latencies.
+ *   It has a fixed size, so recording never allocates. The parser thread
+ *   is the only writer, and any thread can export it while it records.
+ */
+
+inline uint64_t wallClockNs() {
+  timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  return static_cast<uint64_t>(now.tv_sec) * 1000000000ull + now.tv_nsec;
+}
+
+/**
+ * When a chunk of the stream was received: the TSC for cheap intervals on
+ * this host, and the wall clock at the same instant to anchor source times.
+ * A zero stamp means "not stamped" (replays, tests).
+ */
+struct ReceiveStamp {
+  uint64_t tsc = 0;
+  uint64_t realtimeNs = 0;
+
+  static ReceiveStamp now() { return ReceiveStamp{readTsc(), wallClockNs()}; }
+};
+
+/// What the parser knows about the message being dispatched.
+struct MessageTiming {
+  uint64_t sourceNs = 0;   // Header::sourceTime extended to 64 bits
+  uint64_t receiveTsc = 0; // ReceiveStamp::tsc of the chunk that completed it
+};
+
+/**
+ * Resolves each 32-bit sourceTime to the 64-bit time nearest an anchor:
+ * the receive wall clock when the chunk is stamped, otherwise the stream's
+ * previous message. Correct while source-to-receive latency (or the gap
+ * between messages of an unstamped stream) is under 2^31 ns (~2.1 s). Small
+ * steps backwards stay backwards instead of being read as a wrap.
+ */
+class SourceClock {
+public:
+  uint64_t extend(uint32_t sourceTime, uint64_t anchorNs = 0) {
+    if (anchorNs == 0) {
+      if (!started) {
+        started = true;
+        return last = sourceTime;
+      }
+      anchorNs = last;
+    }
+    started = true;
+    int32_t step = static_cast<int32_t>(sourceTime - static_cast<uint32_t>(anchorNs));
+    return last = anchorNs + step;
+  }
+
+private:
+  uint64_t last = 0;
+  bool started = false;
+};
+
+/**
+ * Log-linear latency histogram in nanoseconds. Values below 64 ns are exact.
+ * Above that, every power of two is split into 32 buckets, so any reported
+ * value is within ~3% of the recorded one, from nanoseconds up to the full
+ * 64-bit range, in 15 KiB.
+ */
+class LatencyHistogram {
+public:
+  static constexpr unsigned LinearBits = 6;
+  static constexpr unsigned SubBuckets = 1u << (LinearBits - 1);
+  static constexpr size_t BucketCount = (1u << LinearBits) + (64 - LinearBits) * SubBuckets;
+
+  /// Single writer. Negative latencies (clock skew between hosts) count as 0.
+  void record(int64_t latencyNs) {
+    uint64_t value = 0;
+    if (latencyNs < 0)
+      bump(negative_);
+    else
+      value = static_cast<uint64_t>(latencyNs);
+    bump(counts[bucketOf(value)]);
+    if (value > max_.load(std::memory_order_relaxed))
+      max_.store(value, std::memory_order_relaxed);
+  }
+
+  uint64_t count() const {
+    uint64_t total = 0;
+    for (const auto &bucket : counts)
+      total += bucket.load(std::memory_order_relaxed);
+    return total;
+  }
+
+  uint64_t negative() const { return negative_.load(std::memory_order_relaxed); }
+  uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+
+  /// Highest value equivalent to the q-quantile (0 < q <= 1); 0 if empty.
+  uint64_t percentile(double q) const {
+    uint64_t total = count();
+    if (total == 0)
+      return 0;
+    uint64_t rank = static_cast<uint64_t>(q * total + 0.5);
+    rank = rank == 0 ? 1 : rank;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BucketCount; ++i) {
+      seen += counts[i].load(std::memory_order_relaxed);
+      if (seen >= rank)
+        return std::min(upperBound(i), max());
+    }
+    return max();
+  }
+
+  void print(std::FILE *out, const char *name) const {
+    std::fprintf(out,
+                 "%-20s n %llu  p50 %llu ns  p99 %llu ns  p99.9 %llu ns  p99.99 %llu ns  "
+                 "max %llu ns  negative %llu\n",
+                 name, static_cast<unsigned long long>(count()),
+                 static_cast<unsigned long long>(percentile(0.5)),
+                 static_cast<unsigned long long>(percentile(0.99)),
+                 static_cast<unsigned long long>(percentile(0.999)),
+                 static_cast<unsigned long long>(percentile(0.9999)),
+                 static_cast<unsigned long long>(max()),
+                 static_cast<unsigned long long>(negative()));
+  }
+
+  /// Non-empty buckets as CSV, for plotting or diffing between releases.
+  void exportCsv(std::FILE *out) const {
+    std::fprintf(out, "lower_ns,upper_ns,count\n");
+    for (size_t i = 0; i < BucketCount; ++i) {
+      uint64_t n = counts[i].load(std::memory_order_relaxed);
+      if (n != 0)
+        std::fprintf(out, "%llu,%llu,%llu\n", static_cast<unsigned long long>(lowerBound(i)),
+                     static_cast<unsigned long long>(upperBound(i)),
+                     static_cast<unsigned long long>(n));
+    }
+  }
+
+  static size_t bucketOf(uint64_t value) {
+    if (value < (1u << LinearBits))
+      return value;
+    unsigned exponent = 63 - __builtin_clzll(value);
+    uint64_t mantissa = value >> (exponent - (LinearBits - 1)); // in [32, 64)
+    return (1u << LinearBits) + (exponent - LinearBits) * SubBuckets + (mantissa - SubBuckets);
+  }
+
+  static uint64_t lowerBound(size_t bucket) {
+    if (bucket < (1u << LinearBits))
+      return bucket;
+    size_t offset = bucket - (1u << LinearBits);
+    unsigned exponent = static_cast<unsigned>(offset / SubBuckets) + LinearBits;
+    uint64_t mantissa = offset % SubBuckets + SubBuckets;
+    return mantissa << (exponent - (LinearBits - 1));
+  }
+
+  static uint64_t upperBound(size_t bucket) {
+    if (bucket < (1u << LinearBits))
+      return bucket;
+    unsigned exponent =
+        static_cast<unsigned>((bucket - (1u << LinearBits)) / SubBuckets) + LinearBits;
+    return lowerBound(bucket) + (uint64_t(1) << (exponent - (LinearBits - 1))) - 1;
+  }
+
+private:
+  static void bump(std::atomic<uint64_t> &counter) {
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  std::array<std::atomic<uint64_t>, BucketCount> counts{};
+  std::atomic<uint64_t> negative_{0};
+  std::atomic<uint64_t> max_{0};
+};
@@ -0,0 +1,375 @@
+// Build: g++ -std=c++20 -O2 -march=native -pthread -I../../../../static/code lz4_feed_decompressor.cpp -llz4
+#include <lz4frame.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lockfree/queue.h"
+#include "market_data_parser.h"
+
+/**
+ * LZ4-framed feed decompression ahead of the parser.
+ *
+ * Every compressed stream (an archived session file, a WAN segment) is one
+ * LZ4 frame. Frames are decompressed into a small pool of fixed blocks that
+ * is reused for the whole replay, so the working set stays in L2 instead of
+ * streaming through a fresh buffer per frame. The parser reads each block in
+ * place; the only copy after decompression is the parser's stitching of a
+ * message that straddles two blocks.
+ *
+ * Decompression and parsing run on different threads connected by two SPSC
+ * queues of block indices:
+ *   decompressor --readyChunks--> parser --freeBlocks--> decompressor
+ * so block k+1 (and stream k+1) is being decompressed while block k is
+ * being parsed.
+ *
+ * A corrupt frame throws from `run` (or `runSerial`) after the blocks
+ * decoded before it have been parsed; the decompressor thread hands its
+ * exception over instead of terminating. A frame that is cut short is
+ * counted. Either way the decoder is reset, so it can take the next stream.
+ */
+
+class Lz4FrameDecoder {
+public:
+  Lz4FrameDecoder() {
+    LZ4F_errorCode_t error = LZ4F_createDecompressionContext(&context, LZ4F_VERSION);
+    if (LZ4F_isError(error))
+      throw std::runtime_error(LZ4F_getErrorName(error));
+  }
+
+  ~Lz4FrameDecoder() { LZ4F_freeDecompressionContext(context); }
+
+  Lz4FrameDecoder(const Lz4FrameDecoder &) = delete;
+  Lz4FrameDecoder &operator=(const Lz4FrameDecoder &) = delete;
+
+  /**
+   * Decompresses as much of `src` into `dst` as fits.
+   * On return `srcSize` / `dstSize` hold the bytes consumed / produced.
+   * Returns true once the end of the frame has been reached.
+   */
+  bool decode(const uint8_t *src, size_t &srcSize, uint8_t *dst,
+              size_t &dstSize) {
+    size_t hint = LZ4F_decompress(context, dst, &dstSize, src, &srcSize, nullptr);
+    if (LZ4F_isError(hint))
+      throw std::runtime_error(std::string("LZ4F_decompress: ") +
+                               LZ4F_getErrorName(hint));
+    return hint == 0;
+  }
+
+  /// Drops the state of a frame that was cut short or failed to decode.
+  void reset() { LZ4F_resetDecompressionContext(context); }
+
+private:
+  LZ4F_dctx *context = nullptr;
+};
+
+struct DecompressStats {
+  uint64_t decompressedBytes = 0;
+  uint64_t truncatedStreams = 0; // stream ended in the middle of a message
+  uint64_t incompleteFrames = 0; // stream ended before its frame did
+};
+
+template <typename Handler>
+class Lz4FeedPipeline {
+public:
+  static constexpr size_t BlockSize = 64 * 1024;
+  static constexpr size_t BlockCount = 8;
+
+  explicit Lz4FeedPipeline(Handler &handler)
+      : blocks(new Block[BlockCount]), parser(handler) {
+    for (uint32_t block = 0; block < BlockCount; ++block)
+      freeBlocks.enqueue(block);
+  }
+
+  /// Decompresses on a second thread while parsing on the calling thread.
+  void run(const std::vector<std::vector<uint8_t>> &compressedStreams) {
+    std::exception_ptr failure;
+    std::thread decompressor([this, &compressedStreams, &failure] {
+      try {
+        for (uint32_t stream = 0; stream < compressedStreams.size(); ++stream)
+          decompressStream(compressedStreams[stream], stream);
+      } catch (...) {
+        failure = std::current_exception();
+        publish({Failed, 0, 0, false});
+      }
+    });
+    parseStreams(compressedStreams.size());
+    decompressor.join();
+    if (failure)
+      std::rethrow_exception(failure);
+  }
+
+  /// Decompress-then-parse on one thread, for comparison.
+  void runSerial(const std::vector<std::vector<uint8_t>> &compressedStreams) {
+    uint8_t *block = blocks[0].bytes;
+    for (const std::vector<uint8_t> &compressed : compressedStreams) {
+      size_t srcPos = 0;
+      bool frameEnd = false;
+      while (!frameEnd && srcPos < compressed.size()) {
+        size_t srcSize = compressed.size() - srcPos;
+        size_t dstSize = BlockSize;
+        try {
+          frameEnd = decodeOrReset(compressed.data() + srcPos, srcSize, block, dstSize);
+        } catch (...) {
+          parser.reset();
+          throw;
+        }
+        srcPos += srcSize;
+        stats_.decompressedBytes += dstSize;
+        parser.parse(block, dstSize);
+      }
+      if (!frameEnd)
+        decoder.reset();
+      endStream(frameEnd);
+    }
+  }
+
+  const DecompressStats &stats() const { return stats_; }
+  const ParserStats &parserStats() const { return parser.stats(); }
+
+private:
+  struct alignas(64) Block {
+    uint8_t bytes[BlockSize];
+  };
+
+  static constexpr uint32_t NoBlock = UINT32_MAX;
+  static constexpr uint32_t Failed = UINT32_MAX - 1;
+
+  struct Chunk {
+    uint32_t block; // NoBlock marks the end of `stream`, Failed the end of all
+    uint32_t size;
+    uint32_t stream;
+    bool frameEnd; // with NoBlock: the frame was complete
+  };
+
+  bool decodeOrReset(const uint8_t *src, size_t &srcSize, uint8_t *dst,
+                     size_t &dstSize) {
+    try {
+      return decoder.decode(src, srcSize, dst, dstSize);
+    } catch (...) {
+      decoder.reset();
+      throw;
+    }
+  }
+
+  void decompressStream(const std::vector<uint8_t> &compressed, uint32_t stream) {
+    size_t srcPos = 0;
+    bool frameEnd = false;
+    while (!frameEnd && srcPos < compressed.size()) {
+      uint32_t block;
+      while (!freeBlocks.dequeue(block))
+        std::this_thread::yield();
+
+      // Fill the block completely before handing it over, so the parser
+      // sees few, large chunks.
+      size_t filled = 0;
+      while (!frameEnd && srcPos < compressed.size() && filled < BlockSize) {
+        size_t srcSize = compressed.size() - srcPos;
+        size_t dstSize = BlockSize - filled;
+        try {
+          frameEnd = decodeOrReset(compressed.data() + srcPos, srcSize,
+                                   blocks[block].bytes + filled, dstSize);
+        } catch (...) {
+          // Hand over what decoded cleanly; the block comes back as usual.
+          publish({block, static_cast<uint32_t>(filled), stream, false});
+          throw;
+        }
+        srcPos += srcSize;
+        filled += dstSize;
+      }
+      publish({block, static_cast<uint32_t>(filled), stream, false});
+    }
+    if (!frameEnd)
+      decoder.reset();
+    publish({NoBlock, 0, stream, frameEnd});
+  }
+
+  void parseStreams(size_t streamCount) {
+    size_t finished = 0;
+    Chunk chunk;
+    while (finished < streamCount) {
+      if (!readyChunks.dequeue(chunk)) {
+        std::this_thread::yield();
+        continue;
+      }
+      if (chunk.block == Failed) {
+        parser.reset();
+        return;
+      }
+      if (chunk.block == NoBlock) {
+        endStream(chunk.frameEnd);
+        ++finished;
+        continue;
+      }
+      stats_.decompressedBytes += chunk.size;
+      parser.parse(blocks[chunk.block].bytes, chunk.size);
+      freeBlocks.enqueue(chunk.block);
+    }
+  }
+
+  void publish(const Chunk &chunk) {
+    while (!readyChunks.enqueue(chunk))
+      std::this_thread::yield();
+  }
+
+  /// A message cut off by the end of its frame is counted, not carried into
+  /// the next stream.
+  void endStream(bool frameEnd) {
+    if (!frameEnd)
+      ++stats_.incompleteFrames;
+    if (parser.pendingBytes() != 0)
+      ++stats_.truncatedStreams;
+    parser.reset();
+  }
+
+  std::unique_ptr<Block[]> blocks;
+  LockFreeQueue<uint32_t, BlockCount * 2> freeBlocks;
+  LockFreeQueue<Chunk, BlockCount * 2> readyChunks;
+  Lz4FrameDecoder decoder;
+  MarketDataParser<Handler> parser;
+  DecompressStats stats_;
+};
+
+struct ChecksumHandler {
+  void onQuote(const Header &, const QuoteMessage &quote) {
+    checksum += quote.symbolSeqNum + quote.askVolume + quote.bidVolume;
+  }
+  void onTrade(const Header &, const TradeMessage &trade) {
+    checksum += trade.symbolSeqNum + trade.volume;
+  }
+  void onStockSummary(const Header &, const StockSummary &summary) {
+    checksum += summary.totalVolume;
+  }
+
+  uint64_t checksum = 0;
+};
+
+std::vector<uint8_t> compressFrame(const std::vector<uint8_t> &raw) {
+  std::vector<uint8_t> compressed(LZ4F_compressFrameBound(raw.size(), nullptr));
+  size_t size = LZ4F_compressFrame(compressed.data(), compressed.size(),
+                                   raw.data(), raw.size(), nullptr);
+  if (LZ4F_isError(size))
+    throw std::runtime_error(LZ4F_getErrorName(size));
+  compressed.resize(size);
+  return compressed;
+}
+
+template <typename Run>
+void report(const char *name, Run run) {
+  ChecksumHandler handler;
+  auto pipeline = std::make_unique<Lz4FeedPipeline<ChecksumHandler>>(handler);
+
+  auto start = std::chrono::steady_clock::now();
+  run(*pipeline);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  const DecompressStats &stats = pipeline->stats();
+  std::printf("%-10s %8.1f MB/s  messages: %llu  truncated: %llu  checksum: %llu\n",
+              name, stats.decompressedBytes / elapsed.count() / 1e6,
+              static_cast<unsigned long long>(pipeline->parserStats().messages),
+              static_cast<unsigned long long>(stats.truncatedStreams),
+              static_cast<unsigned long long>(handler.checksum));
+}
+
+using Streams = std::vector<std::vector<uint8_t>>;
+
+/// Checksum of `streams` decoded by a fresh pipeline.
+uint64_t checksumOf(const Streams &streams) {
+  ChecksumHandler handler;
+  auto pipeline = std::make_unique<Lz4FeedPipeline<ChecksumHandler>>(handler);
+  pipeline->runSerial(streams);
+  return handler.checksum;
+}
+
+/**
+ * Damaged input, through one pipeline: a frame cut in half must be counted
+ * and leave the next stream decoding exactly as it would alone; a corrupt
+ * block header must throw from the run (not terminate the process), after
+ * which the pipeline still decodes a good stream.
+ */
+template <typename Run>
+void checkDamaged(const char *name, const Streams &good, Run run) {
+  std::vector<uint8_t> cut(good[0].begin(), good[0].begin() + good[0].size() / 2);
+  // Default preferences give a 7-byte frame header, then blocks of a 4-byte
+  // little-endian size and the data; make the third block's size invalid.
+  std::vector<uint8_t> corrupt = good[2];
+  size_t offset = 7;
+  for (int block = 0; block < 2; ++block) {
+    uint32_t size;
+    std::memcpy(&size, corrupt.data() + offset, sizeof(size));
+    offset += 4 + (size & 0x7FFFFFFF);
+  }
+  uint32_t invalidSize = 0x7FFFFFF0;
+  std::memcpy(corrupt.data() + offset, &invalidSize, sizeof(invalidSize));
+
+  ChecksumHandler handler;
+  auto pipeline = std::make_unique<Lz4FeedPipeline<ChecksumHandler>>(handler);
+  run(*pipeline, Streams{cut, good[1]});
+  bool cutOk = pipeline->stats().incompleteFrames == 1 &&
+               handler.checksum == checksumOf({cut}) + checksumOf({good[1]});
+
+  const char *error = "none";
+  try {
+    run(*pipeline, Streams{corrupt});
+  } catch (const std::runtime_error &e) {
+    error = e.what();
+  }
+  handler.checksum = 0;
+  run(*pipeline, Streams{good[1]});
+  bool recovered = handler.checksum == checksumOf({good[1]});
+  std::printf("%-10s cut frame: %s  corrupt frame: %s  next stream: %s\n", name,
+              cutOk ? "counted, next stream intact" : "WRONG", error,
+              recovered ? "intact" : "WRONG");
+}
+
+int main() {
+  constexpr size_t streamCount = 16;
+  constexpr size_t messagesPerStream = 200000;
+  constexpr uint32_t symbolCount = 512;
+
+  std::mt19937 rng(7);
+  std::vector<uint32_t> seq(symbolCount, 0);
+  std::vector<std::vector<uint8_t>> compressedStreams;
+  size_t rawBytes = 0;
+  size_t compressedBytes = 0;
+  uint32_t sourceTime = 0;
+
+  for (size_t stream = 0; stream < streamCount; ++stream) {
+    std::vector<uint8_t> raw;
+    for (size_t m = 0; m < messagesPerStream; ++m) {
+      uint32_t symbolIndex = rng() % symbolCount;
+      double price = 100.0 + (rng() % 1000) / 100.0;
+      if (rng() % 4 == 0) {
+        TradeMessage trade{symbolIndex, ++seq[symbolIndex],
+                           static_cast<uint32_t>(m), price, 100};
+        encodeMessage(raw, MsgType::Trade, ++sourceTime, trade);
+      } else {
+        QuoteMessage quote{symbolIndex, ++seq[symbolIndex], price + 0.01, 200,
+                           price - 0.01, 300};
+        encodeMessage(raw, MsgType::Quote, ++sourceTime, quote);
+      }
+    }
+    rawBytes += raw.size();
+    compressedStreams.push_back(compressFrame(raw));
+    compressedBytes += compressedStreams.back().size();
+  }
+  std::printf("%zu streams, %zu raw bytes, %zu compressed bytes\n", streamCount,
+              rawBytes, compressedBytes);
+
+  report("serial", [&](auto &pipeline) { pipeline.runSerial(compressedStreams); });
+  report("pipelined", [&](auto &pipeline) { pipeline.run(compressedStreams); });
+  checkDamaged("serial", compressedStreams,
+               [](auto &pipeline, const Streams &streams) { pipeline.runSerial(streams); });
+  checkDamaged("pipelined", compressedStreams,
+               [](auto &pipeline, const Streams &streams) { pipeline.run(streams); });
+  return 0;
+}
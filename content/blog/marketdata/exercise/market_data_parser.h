@@ -0,0 +1,322 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "feed_timing.h"
+
+#pragma pack(push, 1)
+
+/**
+#### **Binary Message Header Format (8 bytes total)**
+| Field          | Size (bytes) | Description |
+|----------------|--------------|----------------------------------------------------------|
+| `MsgSize`      | 2            | Size of the entire message (including header)            |
+| `MsgType`      | 2            | Type of the message (e.g., 140 for Quote,220 for Trade)  |
+| `SourceTimeNS` | 4            | Nanosecond timestamp                                     |
+*/
+
+struct Header {
+  uint16_t msgSize;
+  uint16_t msgType;
+  uint32_t sourceTime;
+};
+
+static_assert(sizeof(Header) == (2 + 2 + 4));
+
+
+/**
+#### **Quote Message (MsgType 140)**
+| Field          | Size (bytes) | Description                        |
+|----------------|--------------|------------------------------------|
+| `SymbolIndex`  | 4            | Unique symbol identifier           |
+| `SymbolSeqNum` | 4            | Sequence number for symbol updates |
+| `AskPrice`     | 8            | Best ask price (scaled in cents)   |
+| `AskVolume`    | 4            | Number of shares available at ask  |
+| `BidPrice`     | 8            | Best bid price (scaled in cents)   |
+| `BidVolume`    | 4            | Number of shares available at bid  |
+
+*/
+
+struct QuoteMessage{
+  uint32_t symbolIndex;
+  uint32_t symbolSeqNum;
+  double askPrice;
+  uint32_t askVolume;
+  double bidPrice;
+  uint32_t bidVolume;
+};
+static_assert(sizeof(QuoteMessage) == (4+4+8+4+8+4));
+/**
+#### **Trade Message (MsgType 220)**
+| Field          | Size (bytes) | Description                   |
+|----------------|--------------|-------------------------------|
+| `SymbolIndex`  | 4            | Unique symbol identifier      |
+| `SymbolSeqNum` | 4            | Sequence number               |
+| `TradeID`      | 4            | Unique trade ID               |
+| `Price`        | 8            | Trade price (scaled in cents) |
+| `Volume`       | 4            | Shares traded                 |
+*/
+
+struct TradeMessage {
+  uint32_t symbolIndex;
+  uint32_t symbolSeqNum;
+  uint32_t tradeID;
+  double price;
+  uint32_t volume;
+};
+static_assert(sizeof(TradeMessage) == (4+4+4+8+4));
+
+
+/**
+#### **Stock Summary Message (MsgType 223)**
+| Field         | Size (bytes) | Description                 |
+|---------------|--------------|-----------------------------|
+| `SymbolIndex` | 4            | Unique symbol identifier    |
+| `HighPrice`   | 8            | Highest price in the period |
+| `LowPrice`    | 8            | Lowest price in the period  |
+| `Open`        | 8            | Opening price               |
+| `Close`       | 8            | Closing price               |
+| `TotalVolume` | 8            | Total volume traded         |
+ */
+
+struct StockSummary{
+  uint32_t symbolIndex;
+  double highPrice;
+  double lowPrice;
+  double open;
+  double close;
+  uint64_t totalVolume;
+};
+static_assert(sizeof(StockSummary) == (4+8+8+8+8+8));
+
+#pragma pack(pop)
+
+enum class MsgType : uint16_t {
+  Quote = 140,
+  Trade = 220,
+  StockSummary = 223,
+};
+
+/**
+ * Appends one framed message (header + body) to `stream`.
+ * Used by the simulators and demos to produce Pillar-format bytes.
+ */
+template <typename Body>
+void encodeMessage(std::vector<uint8_t> &stream, MsgType type,
+                   uint32_t sourceTime, const Body &body) {
+  Header header{static_cast<uint16_t>(sizeof(Header) + sizeof(Body)),
+                static_cast<uint16_t>(type), sourceTime};
+  size_t offset = stream.size();
+  stream.resize(offset + header.msgSize);
+  std::memcpy(stream.data() + offset, &header, sizeof(Header));
+  std::memcpy(stream.data() + offset + sizeof(Header), &body, sizeof(Body));
+}
+
+struct ParserStats {
+  uint64_t messages = 0;  // dispatched to the handler
+  uint64_t malformed = 0; // body shorter than the message type requires
+  uint64_t unknown = 0;   // msgType we do not decode
+};
+
+/**
+ * Incremental parser for a Pillar byte stream.
+ * - Complete messages are decoded straight out of the caller's buffer; no
+ *   copy of the stream is made.
+ * - A message split across two chunks is stitched in `pending`, which is
+ *   reserved once for the largest possible message (msgSize is 16 bits), so
+ *   the hot path never allocates.
+ * - `msgSize` is authoritative: a message longer than its known layout is
+ *   accepted and the trailing bytes skipped (newer feed versions append
+ *   fields), a shorter one is counted as malformed and skipped.
+ * - A header with `msgSize < sizeof(Header)` cannot be framed past, so the
+ *   rest of the chunk is dropped.
+ *
+ * - Every dispatched message gets a MessageTiming: its sourceTime extended
+ *   to 64 bits by the parser's SourceClock (one parser per stream), and the
+ *   receive TSC of the chunk passed to `parse`. For stamped chunks the
+ *   source-to-parse latency goes into `latency()`, which can be exported
+ *   from any thread while the parser runs.
+ *
+ * Handler must provide:
+ *   void onQuote(const Header&, const QuoteMessage&);
+ *   void onTrade(const Header&, const TradeMessage&);
+ *   void onStockSummary(const Header&, const StockSummary&);
+ * and may provide
+ *   void onTiming(const MessageTiming&);
+ * which is called just before each of the above.
+ */
+template <typename Handler>
+class MarketDataParser {
+public:
+  explicit MarketDataParser(Handler &handler) : handler(handler) {
+    pending.reserve(UINT16_MAX);
+  }
+
+  void parse(const std::vector<uint8_t> &stream, const ReceiveStamp &stamp = {}) {
+    parse(stream.data(), stream.size(), stamp);
+  }
+
+  /**
+   * `stamp` is when `data` was received; leave it empty for replays. The
+   * parse time is taken once per chunk, not per message.
+   */
+  void parse(const uint8_t *data, size_t size, const ReceiveStamp &stamp = {}) {
+    stamp_ = stamp;
+    parseNs = 0;
+    if (stamp.realtimeNs != 0)
+      parseNs = stamp.realtimeNs +
+                static_cast<uint64_t>((readTsc() - stamp.tsc) * tscNsPerTick());
+
+    if (!pending.empty()) {
+      size_t used = completePending(data, size);
+      data += used;
+      size -= used;
+      if (!pending.empty())
+        return;
+    }
+
+    size_t offset = 0;
+    while (size - offset >= sizeof(Header)) {
+      Header header;
+      std::memcpy(&header, data + offset, sizeof(Header));
+      if (header.msgSize < sizeof(Header)) {
+        ++stats_.malformed;
+        return;
+      }
+      if (size - offset < header.msgSize)
+        break;
+      dispatch(header, data + offset);
+      offset += header.msgSize;
+    }
+    pending.assign(data + offset, data + size);
+  }
+
+  const ParserStats &stats() const { return stats_; }
+
+  /// Source-to-parse latency of stamped messages.
+  const LatencyHistogram &latency() const { return latency_; }
+
+  /// Bytes of a partial message waiting for the rest of the stream.
+  size_t pendingBytes() const { return pending.size(); }
+
+  /// Drops any partial message, e.g. when its stream has ended.
+  void reset() { pending.clear(); }
+
+private:
+  template <typename Body>
+  static Body decode(const uint8_t *message) {
+    Body body;
+    std::memcpy(&body, message + sizeof(Header), sizeof(Body));
+    return body;
+  }
+
+  /**
+   * Validation is one table lookup and one compare, whatever the type:
+   * - `kinds` maps every possible msgType to a small kind index (0 for
+   *   types we do not decode). It spans the full 16-bit range, but only the
+   *   cache lines of types actually on the wire are ever touched.
+   * - `minSizes[kind]` is the smallest msgSize that holds the body; for the
+   *   unknown kind it is out of reach, so unknown and short messages share
+   *   the same rejection branch, which valid traffic never takes.
+   * Counting rejects without any branch (and always dispatching through a
+   * no-op kind) measured slower: the extra counter updates cost more than
+   * the never-taken branch.
+   */
+  enum Kind : uint8_t { UnknownKind, QuoteKind, TradeKind, StockSummaryKind, KindCount };
+
+  static constexpr std::array<uint8_t, 65536> makeKinds() {
+    std::array<uint8_t, 65536> kinds{};
+    kinds[static_cast<uint16_t>(MsgType::Quote)] = QuoteKind;
+    kinds[static_cast<uint16_t>(MsgType::Trade)] = TradeKind;
+    kinds[static_cast<uint16_t>(MsgType::StockSummary)] = StockSummaryKind;
+    return kinds;
+  }
+
+  static constexpr std::array<uint8_t, 65536> kinds = makeKinds();
+
+  static constexpr std::array<uint32_t, KindCount> minSizes = {
+      UINT16_MAX + 1,
+      sizeof(Header) + sizeof(QuoteMessage),
+      sizeof(Header) + sizeof(TradeMessage),
+      sizeof(Header) + sizeof(StockSummary),
+  };
+
+  void dispatch(const Header &header, const uint8_t *message) {
+    uint8_t kind = kinds[header.msgType];
+    if (__builtin_expect(header.msgSize < minSizes[kind], 0)) {
+      ++(kind == UnknownKind ? stats_.unknown : stats_.malformed);
+      return;
+    }
+    ++stats_.messages;
+
+    // Unstamped chunks for a handler without onTiming skip all of this: the
+    // clock only needs state when it has no receive time to anchor on.
+    constexpr bool wantsTiming = requires { handler.onTiming(timing); };
+    if (wantsTiming || parseNs != 0) {
+      timing.sourceNs = clock.extend(header.sourceTime, stamp_.realtimeNs);
+      timing.receiveTsc = stamp_.tsc;
+      if (parseNs != 0)
+        latency_.record(static_cast<int64_t>(parseNs - timing.sourceNs));
+      if constexpr (wantsTiming)
+        handler.onTiming(timing);
+    }
+
+    switch (kind) {
+    case QuoteKind:
+      handler.onQuote(header, decode<QuoteMessage>(message));
+      break;
+    case TradeKind:
+      handler.onTrade(header, decode<TradeMessage>(message));
+      break;
+    case StockSummaryKind:
+      handler.onStockSummary(header, decode<StockSummary>(message));
+      break;
+    }
+  }
+
+  /**
+   * Feeds the head of a new chunk into the carried-over partial message.
+   * Returns the number of bytes of `data` it used.
+   */
+  size_t completePending(const uint8_t *data, size_t size) {
+    size_t used = 0;
+    if (pending.size() < sizeof(Header)) {
+      used = std::min(sizeof(Header) - pending.size(), size);
+      pending.insert(pending.end(), data, data + used);
+      if (pending.size() < sizeof(Header))
+        return used;
+    }
+
+    Header header;
+    std::memcpy(&header, pending.data(), sizeof(Header));
+    if (header.msgSize < sizeof(Header)) {
+      ++stats_.malformed;
+      pending.clear();
+      return size;
+    }
+
+    size_t take = std::min(header.msgSize - pending.size(), size - used);
+    pending.insert(pending.end(), data + used, data + used + take);
+    used += take;
+    if (pending.size() == header.msgSize) {
+      dispatch(header, pending.data());
+      pending.clear();
+    }
+    return used;
+  }
+
+  Handler &handler;
+  std::vector<uint8_t> pending;
+  ParserStats stats_;
+
+  SourceClock clock;
+  ReceiveStamp stamp_;
+  uint64_t parseNs = 0;
+  MessageTiming timing;
+  LatencyHistogram latency_;
+};
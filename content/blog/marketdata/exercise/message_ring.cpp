@@ -0,0 +1,178 @@
+// Build: g++ -std=c++20 -O2 -march=native -pthread -I../../../../static/code message_ring.cpp
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "lockfree/byte_queue.h"
+#include "lockfree/queue.h"
+#include "market_data_parser.h"
+
+/**
+ * Handing raw Pillar messages from a receive thread to a parsing thread.
+ *
+ * Quotes, trades and summaries are 40, 32 and 52 bytes framed. The same
+ * stream goes through:
+ * - a ByteQueue, one record per message: each message is copied in as it
+ *   came off the wire and parsed in place by the consumer, taking only its
+ *   own bytes (plus a 4-byte length) in the ring,
+ * - a LockFreeQueue of 52-byte slots, the largest framed message, which is
+ *   what a fixed-size queue forces on a mixed stream.
+ * Both consumers run the same MarketDataParser and must see every message;
+ * the table shows throughput and the ring bytes each message cost.
+ */
+
+constexpr size_t Messages = 1'000'000;
+constexpr int Passes = 5;
+constexpr size_t LargestMessage = sizeof(Header) + sizeof(StockSummary);
+
+using MessageRing = ByteQueue<256 * 1024>;
+using MessageSlot = std::array<uint8_t, LargestMessage>;
+using SlotQueue = LockFreeQueue<MessageSlot, 4096>;
+
+struct ChecksumHandler {
+  uint64_t sum = 0;
+
+  void onQuote(const Header &, const QuoteMessage &quote) { sum += quote.symbolSeqNum; }
+  void onTrade(const Header &, const TradeMessage &trade) { sum += trade.tradeID; }
+  void onStockSummary(const Header &, const StockSummary &summary) {
+    sum += summary.totalVolume;
+  }
+};
+
+std::vector<uint8_t> makeStream() {
+  std::mt19937 rng(7);
+  std::vector<uint8_t> stream;
+  for (uint32_t m = 0; m < Messages; ++m) {
+    uint32_t roll = rng() % 100;
+    if (roll < 70) {
+      encodeMessage(stream, MsgType::Quote, m, QuoteMessage{m % 512, m, 10.01, 100, 9.99, 200});
+    } else if (roll < 95) {
+      encodeMessage(stream, MsgType::Trade, m, TradeMessage{m % 512, m, m, 10.0, 100});
+    } else {
+      encodeMessage(stream, MsgType::StockSummary, m,
+                    StockSummary{m % 512, 10.5, 9.5, 10.0, 10.2, m});
+    }
+  }
+  return stream;
+}
+
+/// Calls `send(message, size)` for every framed message, `Passes` times.
+template <typename Send>
+void replay(const std::vector<uint8_t> &stream, Send send) {
+  for (int pass = 0; pass < Passes; ++pass) {
+    for (size_t offset = 0; offset < stream.size();) {
+      Header header;
+      std::memcpy(&header, stream.data() + offset, sizeof(Header));
+      send(stream.data() + offset, header.msgSize);
+      offset += header.msgSize;
+    }
+  }
+}
+
+struct RunResult {
+  double seconds;
+  uint64_t messages;
+  uint64_t checksum;
+};
+
+RunResult viaByteQueue(const std::vector<uint8_t> &stream) {
+  auto ring = std::make_unique<MessageRing>();
+  ChecksumHandler handler;
+  MarketDataParser<ChecksumHandler> parser(handler);
+
+  auto start = std::chrono::steady_clock::now();
+  std::thread consumer([&] {
+    for (uint64_t received = 0; received < Messages * Passes;) {
+      std::span<const uint8_t> record = ring->try_peek();
+      if (record.empty()) {
+        std::this_thread::yield();
+        continue;
+      }
+      parser.parse(record.data(), record.size());
+      ring->release();
+      ++received;
+    }
+  });
+  replay(stream, [&](const uint8_t *message, size_t size) {
+    uint8_t *payload;
+    while ((payload = ring->try_claim(size)) == nullptr)
+      std::this_thread::yield();
+    std::memcpy(payload, message, size);
+    ring->commit(size);
+  });
+  consumer.join();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return {elapsed.count(), parser.stats().messages, handler.sum};
+}
+
+RunResult viaSlotQueue(const std::vector<uint8_t> &stream) {
+  auto queue = std::make_unique<SlotQueue>();
+  ChecksumHandler handler;
+  MarketDataParser<ChecksumHandler> parser(handler);
+
+  auto start = std::chrono::steady_clock::now();
+  std::thread consumer([&] {
+    for (uint64_t received = 0; received < Messages * Passes;) {
+      const MessageSlot *slot = queue->try_peek();
+      if (slot == nullptr) {
+        std::this_thread::yield();
+        continue;
+      }
+      Header header;
+      std::memcpy(&header, slot->data(), sizeof(Header));
+      parser.parse(slot->data(), header.msgSize);
+      queue->release();
+      ++received;
+    }
+  });
+  replay(stream, [&](const uint8_t *message, size_t size) {
+    MessageSlot *slot;
+    while ((slot = queue->try_claim()) == nullptr)
+      std::this_thread::yield();
+    std::memcpy(slot->data(), message, size);
+    queue->commit();
+  });
+  consumer.join();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return {elapsed.count(), parser.stats().messages, handler.sum};
+}
+
+int main() {
+  std::vector<uint8_t> stream = makeStream();
+
+  ChecksumHandler reference;
+  MarketDataParser<ChecksumHandler> direct(reference);
+  for (int pass = 0; pass < Passes; ++pass)
+    direct.parse(stream);
+
+  size_t ringBytes = 0;
+  replay(stream, [&](const uint8_t *, size_t size) { ringBytes += MessageRing::recordSize(size); });
+
+  std::printf("%zu messages, %.1f bytes framed on average\n", Messages * Passes,
+              static_cast<double>(stream.size()) / Messages);
+  std::printf("%-22s %12s %16s\n", "", "M msgs/s", "ring bytes/msg");
+  struct {
+    const char *name;
+    RunResult result;
+    double bytesPerMessage;
+  } runs[] = {
+      {"ByteQueue", viaByteQueue(stream), static_cast<double>(ringBytes) / (Messages * Passes)},
+      {"LockFreeQueue<52 B>", viaSlotQueue(stream), static_cast<double>(sizeof(MessageSlot))},
+  };
+  for (const auto &run : runs) {
+    if (run.result.messages != Messages * Passes || run.result.checksum != reference.sum) {
+      std::fprintf(stderr, "%s: lost or corrupted messages\n", run.name);
+      return 1;
+    }
+    std::printf("%-22s %12.1f %16.1f\n", run.name,
+                run.result.messages / run.result.seconds / 1e6, run.bytesPerMessage);
+  }
+  return 0;
+}
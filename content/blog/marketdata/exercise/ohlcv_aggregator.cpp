@@ -0,0 +1,181 @@
+// Build: g++ -std=c++20 -O2 -march=native ohlcv_aggregator.cpp
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "market_data_parser.h"
+
+/**
+ * Per-symbol OHLCV + VWAP aggregation driven by TradeMessage.
+ *
+ * State is a dense structure-of-arrays table indexed by symbolIndex: one
+ * array per field, sized once for the symbol universe. A trade touches one
+ * slot of each array and never allocates.
+ *
+ * Bars are time-bucketed on the trade's source time, as extended to 64 bits
+ * by the parser (see MessageTiming): every `barInterval` nanoseconds the bar
+ * closes and one StockSummary-shaped record (plus its VWAP) is emitted per
+ * symbol that traded in it. Symbols are remembered in
+ * `active` when they first trade in a bar, so closing a bar costs only the
+ * symbols that traded, not the whole universe. An interval of 0 means a
+ * single session bar, closed by `flush`. A trade for a symbolIndex outside
+ * the universe is dropped and counted in `unknownSymbols`.
+ *
+ * Sink must provide:
+ *   void onBar(uint64_t barStartNs, const StockSummary&, double vwap);
+ */
+template <typename Sink>
+class OhlcvAggregator {
+public:
+  OhlcvAggregator(Sink &sink, size_t symbolCount, uint64_t barInterval)
+      : sink(sink), barInterval(barInterval), open(symbolCount), high(symbolCount),
+        low(symbolCount), close(symbolCount), notional(symbolCount), volume(symbolCount),
+        trades(symbolCount, 0) {
+    active.reserve(symbolCount);
+  }
+
+  void onQuote(const Header &, const QuoteMessage &) {}
+  void onStockSummary(const Header &, const StockSummary &) {}
+
+  void onTiming(const MessageTiming &timing) { sourceNs = timing.sourceNs; }
+
+  void onTrade(const Header &, const TradeMessage &trade) { onTrade(sourceNs, trade); }
+
+  void onTrade(uint64_t timeNs, const TradeMessage &trade) {
+    uint32_t symbol = trade.symbolIndex;
+    if (symbol >= trades.size()) {
+      ++unknownSymbols;
+      return;
+    }
+    if (timeNs >= barEnd)
+      roll(timeNs);
+
+    double price = trade.price;
+    if (trades[symbol] == 0) {
+      active.push_back(symbol);
+      open[symbol] = high[symbol] = low[symbol] = price;
+      notional[symbol] = 0;
+      volume[symbol] = 0;
+    } else {
+      high[symbol] = std::max(high[symbol], price);
+      low[symbol] = std::min(low[symbol], price);
+    }
+    close[symbol] = price;
+    notional[symbol] += price * trade.volume;
+    volume[symbol] += trade.volume;
+    ++trades[symbol];
+  }
+
+  /// Closes the current bar, e.g. from a timer when no trade has arrived.
+  void flush() {
+    for (uint32_t symbol : active) {
+      StockSummary summary{symbol, high[symbol], low[symbol], open[symbol], close[symbol],
+                           volume[symbol]};
+      double vwap = volume[symbol] ? notional[symbol] / volume[symbol] : close[symbol];
+      sink.onBar(barStart, summary, vwap);
+      trades[symbol] = 0;
+    }
+    active.clear();
+  }
+
+  uint64_t unknownSymbols = 0;
+
+private:
+  void roll(uint64_t timeNs) {
+    flush();
+    if (barInterval == 0) {
+      barStart = timeNs;
+      barEnd = UINT64_MAX;
+    } else {
+      barStart = timeNs - timeNs % barInterval;
+      barEnd = barStart + barInterval;
+    }
+  }
+
+  Sink &sink;
+  uint64_t barInterval;
+  uint64_t barStart = 0;
+  uint64_t barEnd = 0;
+  uint64_t sourceNs = 0; // of the message being dispatched
+
+  std::vector<double> open;
+  std::vector<double> high;
+  std::vector<double> low;
+  std::vector<double> close;
+  std::vector<double> notional; // sum of price * volume, for VWAP
+  std::vector<uint64_t> volume;
+  std::vector<uint32_t> trades; // 0 = not traded in the current bar
+  std::vector<uint32_t> active; // symbols traded in the current bar
+};
+
+struct BarCollector {
+  void onBar(uint64_t barStartNs, const StockSummary &summary, double vwap) {
+    ++bars;
+    totalVolume += summary.totalVolume;
+    if (summary.symbolIndex == watched && printed < 5) {
+      std::printf("[Bar %llu] SymbolIndex: %u, Open: %.2f, High: %.2f, Low: %.2f, "
+                  "Close: %.2f, Volume: %llu, VWAP: %.4f\n",
+                  static_cast<unsigned long long>(barStartNs), summary.symbolIndex,
+                  summary.open, summary.highPrice, summary.lowPrice, summary.close,
+                  static_cast<unsigned long long>(summary.totalVolume), vwap);
+      ++printed;
+    }
+  }
+
+  uint32_t watched = 0;
+  int printed = 0;
+  uint64_t bars = 0;
+  uint64_t totalVolume = 0;
+};
+
+int main() {
+  constexpr size_t symbolCount = 8000;
+  constexpr size_t tradeCount = 10000000;
+  constexpr uint64_t barInterval = 1000000000; // 1 s bars
+
+  // Ten million trades spread over ~60 s, skewed toward a few hundred
+  // liquid names as in a real session.
+  std::mt19937 rng(5);
+  std::vector<double> price(symbolCount);
+  for (double &p : price)
+    p = 10.0 + rng() % 40000 / 100.0;
+
+  std::vector<uint8_t> stream;
+  stream.reserve(tradeCount * (sizeof(Header) + sizeof(TradeMessage)));
+  std::vector<uint32_t> seq(symbolCount, 0);
+  uint64_t volumeSent = 0;
+  for (uint32_t t = 0; t < tradeCount; ++t) {
+    uint32_t symbol = (rng() % 4) ? rng() % 300 : rng() % symbolCount;
+    price[symbol] = std::max(0.01, price[symbol] + ((int)(rng() % 5) - 2) / 100.0);
+    uint32_t volume = 100 * (1 + rng() % 10);
+    volumeSent += volume;
+    TradeMessage trade{symbol, ++seq[symbol], t, price[symbol], volume};
+    uint32_t sourceTime = static_cast<uint32_t>(uint64_t(t) * 6000); // 6 µs apart, wraps
+    encodeMessage(stream, MsgType::Trade, sourceTime, trade);
+  }
+  // One trade for a symbol outside the universe, which must be dropped.
+  TradeMessage unknown{static_cast<uint32_t>(symbolCount), 1, 0, 1.0, 100};
+  encodeMessage(stream, MsgType::Trade, static_cast<uint32_t>(uint64_t(tradeCount) * 6000),
+                unknown);
+
+  BarCollector collector;
+  OhlcvAggregator<BarCollector> aggregator(collector, symbolCount, barInterval);
+  MarketDataParser<OhlcvAggregator<BarCollector>> parser(aggregator);
+
+  auto start = std::chrono::steady_clock::now();
+  parser.parse(stream);
+  aggregator.flush();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  std::printf("%zu trades -> %llu bars in %.3f s: %.1f ns/trade, %.1f M trades/s "
+              "(parse + aggregate)\n",
+              tradeCount, static_cast<unsigned long long>(collector.bars), elapsed.count(),
+              elapsed.count() * 1e9 / tradeCount, tradeCount / elapsed.count() / 1e6);
+  std::printf("volume in bars matches volume sent: %s, unknown symbols dropped: %llu\n",
+              collector.totalVolume == volumeSent ? "yes" : "NO",
+              static_cast<unsigned long long>(aggregator.unknownSymbols));
+  return 0;
+}
@@ -0,0 +1,474 @@
+// Build: g++ -std=c++20 -O2 -march=native pcap_reader.cpp
+//
+// Usage: pcap_reader <capture.pcap|capture.pcapng> [--paced] [--speed X] [--port N]
+//        pcap_reader --generate <out.pcap>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "market_data_parser.h"
+
+/**
+ * pcap / pcapng capture reader feeding the Pillar parser.
+ *
+ * The capture file is mmapped read-only. For every captured frame the reader
+ * walks the link, IPv4 and UDP headers, and hands the UDP payload to the
+ * caller as a span into the mapping: headers are skipped by offset, never
+ * copied out. Capture timestamps are normalized to nanoseconds whatever the
+ * file's resolution, so a replay can run flat out or paced to the original
+ * inter-packet gaps.
+ *
+ * Supported: classic pcap (µs and ns magic, either byte order), pcapng
+ * (EPB/SPB blocks, per-interface if_tsresol), Ethernet with VLAN tags, Linux
+ * cooked (SLL) and raw IPv4 link types.
+ */
+
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw std::runtime_error("cannot open " + path);
+    struct stat info;
+    if (fstat(fd, &info) < 0 || info.st_size == 0) {
+      close(fd);
+      throw std::runtime_error("cannot stat or empty file " + path);
+    }
+    size = static_cast<size_t>(info.st_size);
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+      throw std::runtime_error("cannot mmap " + path);
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    data = static_cast<const uint8_t *>(mapping);
+  }
+
+  ~MappedFile() { munmap(const_cast<uint8_t *>(data), size); }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  std::span<const uint8_t> bytes() const { return {data, size}; }
+
+private:
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+};
+
+struct UdpDatagram {
+  uint64_t timestampNs; // capture time
+  uint32_t dstAddr;     // host byte order
+  uint16_t dstPort;     // host byte order
+  std::span<const uint8_t> payload;
+};
+
+struct PcapStats {
+  uint64_t frames = 0;
+  uint64_t datagrams = 0;
+  uint64_t skipped = 0;   // not IPv4/UDP, or an IP fragment
+  uint64_t truncated = 0; // snaplen cut the datagram short
+};
+
+enum LinkType : uint32_t {
+  LinkEthernet = 1,
+  LinkRawIp = 101,
+  LinkLinuxSll = 113,
+};
+
+class PcapReader {
+public:
+  explicit PcapReader(const std::string &path) : file(path) {}
+
+  /// Calls `onDatagram(const UdpDatagram&)` for every UDP datagram in order.
+  template <typename OnDatagram>
+  void forEach(OnDatagram &&onDatagram) {
+    std::span<const uint8_t> bytes = file.bytes();
+    if (bytes.size() < 4)
+      throw std::runtime_error("file too short for a capture header");
+    uint32_t magic = load<uint32_t>(bytes.data(), false);
+    if (magic == 0x0A0D0D0A)
+      readPcapNg(bytes, onDatagram);
+    else
+      readPcap(bytes, magic, onDatagram);
+  }
+
+  const PcapStats &stats() const { return stats_; }
+
+private:
+  template <typename T>
+  static T load(const uint8_t *at, bool swapped) {
+    T value;
+    std::memcpy(&value, at, sizeof(T));
+    if (swapped) {
+      if constexpr (sizeof(T) == 2)
+        value = __builtin_bswap16(value);
+      else if constexpr (sizeof(T) == 4)
+        value = __builtin_bswap32(value);
+    }
+    return value;
+  }
+
+  template <typename OnDatagram>
+  void readPcap(std::span<const uint8_t> bytes, uint32_t magic, OnDatagram &onDatagram) {
+    bool swapped;
+    uint64_t fractionToNs;
+    switch (magic) {
+    case 0xA1B2C3D4: swapped = false; fractionToNs = 1000; break;
+    case 0xD4C3B2A1: swapped = true; fractionToNs = 1000; break;
+    case 0xA1B23C4D: swapped = false; fractionToNs = 1; break;
+    case 0x4D3CB2A1: swapped = true; fractionToNs = 1; break;
+    default: throw std::runtime_error("not a pcap or pcapng file");
+    }
+
+    constexpr size_t fileHeaderSize = 24;
+    constexpr size_t recordHeaderSize = 16;
+    if (bytes.size() < fileHeaderSize)
+      throw std::runtime_error("truncated pcap header");
+    uint32_t linkType = load<uint32_t>(bytes.data() + 20, swapped) & 0xFFFF;
+
+    size_t offset = fileHeaderSize;
+    while (bytes.size() - offset >= recordHeaderSize) {
+      const uint8_t *record = bytes.data() + offset;
+      uint64_t seconds = load<uint32_t>(record, swapped);
+      uint64_t fraction = load<uint32_t>(record + 4, swapped);
+      uint32_t capturedLength = load<uint32_t>(record + 8, swapped);
+      offset += recordHeaderSize;
+      if (bytes.size() - offset < capturedLength)
+        break; // file cut off mid-record
+      frame(bytes.subspan(offset, capturedLength), linkType,
+            seconds * 1000000000ull + fraction * fractionToNs, onDatagram);
+      offset += capturedLength;
+    }
+  }
+
+  template <typename OnDatagram>
+  void readPcapNg(std::span<const uint8_t> bytes, OnDatagram &onDatagram) {
+    struct Interface {
+      uint32_t linkType;
+      uint64_t unitsPerSecond;
+    };
+    std::vector<Interface> interfaces;
+    bool swapped = false;
+
+    size_t offset = 0;
+    while (bytes.size() - offset >= 12) {
+      const uint8_t *block = bytes.data() + offset;
+      uint32_t type = load<uint32_t>(block, swapped);
+      if (type == 0x0A0D0D0A) {
+        // Section header: the byte-order magic decides how the whole
+        // section is read, and interface ids restart.
+        swapped = load<uint32_t>(block + 8, false) != 0x1A2B3C4D;
+        interfaces.clear();
+      }
+      uint32_t length = load<uint32_t>(block + 4, swapped);
+      if (length < 12 || bytes.size() - offset < length)
+        break;
+
+      switch (type) {
+      case 1: { // Interface Description Block
+        if (length < 20)
+          break;
+        Interface interface{load<uint16_t>(block + 8, swapped), 1000000};
+        parseTsResolution(block + 16, block + length - 4, swapped, interface.unitsPerSecond);
+        interfaces.push_back(interface);
+        break;
+      }
+      case 6: { // Enhanced Packet Block
+        if (length < 32)
+          break;
+        uint32_t interfaceId = load<uint32_t>(block + 8, swapped);
+        if (interfaceId >= interfaces.size())
+          break;
+        const Interface &interface = interfaces[interfaceId];
+        uint64_t units = (static_cast<uint64_t>(load<uint32_t>(block + 12, swapped)) << 32) |
+                         load<uint32_t>(block + 16, swapped);
+        uint32_t capturedLength = load<uint32_t>(block + 20, swapped);
+        if (capturedLength > length - 32)
+          break;
+        frame(bytes.subspan(offset + 28, capturedLength), interface.linkType,
+              toNanoseconds(units, interface.unitsPerSecond), onDatagram);
+        break;
+      }
+      case 3: { // Simple Packet Block: no timestamp
+        if (interfaces.empty() || length < 16)
+          break;
+        uint32_t capturedLength = std::min<uint32_t>(load<uint32_t>(block + 8, swapped), length - 16);
+        frame(bytes.subspan(offset + 12, capturedLength), interfaces[0].linkType, 0, onDatagram);
+        break;
+      }
+      default:
+        break;
+      }
+      offset += length;
+    }
+  }
+
+  /// A resolution too fine for 64 bits (beyond 10^-19 or 2^-63 s) is
+  /// ignored, leaving the default of microseconds.
+  static void parseTsResolution(const uint8_t *option, const uint8_t *end, bool swapped,
+                                uint64_t &unitsPerSecond) {
+    while (end - option >= 4) {
+      uint16_t code = load<uint16_t>(option, swapped);
+      uint16_t length = load<uint16_t>(option + 2, swapped);
+      if (code == 0 || end - option - 4 < length)
+        return;
+      if (code == 9 && length == 1) { // if_tsresol
+        uint8_t resolution = option[4];
+        uint64_t base = (resolution & 0x80) ? 2 : 10;
+        int exponent = resolution & 0x7F;
+        if (exponent <= (base == 2 ? 63 : 19)) {
+          unitsPerSecond = 1;
+          for (int i = 0; i < exponent; ++i)
+            unitsPerSecond *= base;
+        }
+      }
+      option += 4 + ((length + 3u) & ~3u);
+    }
+  }
+
+  /// Exact for any resolution: the product needs at most 94 bits.
+  static uint64_t toNanoseconds(uint64_t units, uint64_t unitsPerSecond) {
+    return static_cast<uint64_t>(static_cast<unsigned __int128>(units) * 1000000000u /
+                                 unitsPerSecond);
+  }
+
+  template <typename OnDatagram>
+  void frame(std::span<const uint8_t> bytes, uint32_t linkType, uint64_t timestampNs,
+             OnDatagram &onDatagram) {
+    ++stats_.frames;
+    size_t offset = 0;
+    uint16_t etherType = 0;
+
+    switch (linkType) {
+    case LinkEthernet:
+      if (bytes.size() < 14)
+        return skip();
+      etherType = load<uint16_t>(bytes.data() + 12, true);
+      offset = 14;
+      while ((etherType == 0x8100 || etherType == 0x88A8) && bytes.size() >= offset + 4) {
+        etherType = load<uint16_t>(bytes.data() + offset + 2, true);
+        offset += 4;
+      }
+      break;
+    case LinkLinuxSll:
+      if (bytes.size() < 16)
+        return skip();
+      etherType = load<uint16_t>(bytes.data() + 14, true);
+      offset = 16;
+      break;
+    case LinkRawIp:
+      etherType = 0x0800;
+      break;
+    default:
+      return skip();
+    }
+    if (etherType != 0x0800 || bytes.size() < offset + 20)
+      return skip();
+
+    const uint8_t *ip = bytes.data() + offset;
+    size_t ipHeaderLength = (ip[0] & 0x0F) * 4u;
+    uint16_t totalLength = load<uint16_t>(ip + 2, true);
+    uint16_t fragment = load<uint16_t>(ip + 6, true);
+    if ((ip[0] >> 4) != 4 || ip[9] != 17 /* UDP */ || (fragment & 0x3FFF) != 0 ||
+        ipHeaderLength < 20)
+      return skip();
+
+    size_t udpOffset = offset + ipHeaderLength;
+    if (bytes.size() < udpOffset + 8)
+      return truncated();
+    const uint8_t *udp = bytes.data() + udpOffset;
+    uint16_t udpLength = load<uint16_t>(udp + 4, true);
+    if (udpLength < 8 || udpLength > totalLength - ipHeaderLength)
+      return skip();
+    if (bytes.size() < udpOffset + udpLength)
+      return truncated();
+
+    ++stats_.datagrams;
+    onDatagram(UdpDatagram{timestampNs, load<uint32_t>(ip + 16, true),
+                           load<uint16_t>(udp + 2, true),
+                           bytes.subspan(udpOffset + 8, udpLength - 8u)});
+  }
+
+  void skip() { ++stats_.skipped; }
+  void truncated() { ++stats_.truncated; }
+
+  MappedFile file;
+  PcapStats stats_;
+};
+
+/**
+ * Feeds every datagram of a capture to a parser.
+ * - speed == 0: as fast as possible.
+ * - speed > 0: paced to the capture's inter-packet gaps, divided by `speed`
+ *   (1.0 is real time). Pacing spins on the steady clock against the
+ *   capture timeline, so scheduling jitter does not accumulate.
+ * - port != 0 keeps only datagrams sent to that UDP port.
+ */
+template <typename Handler>
+void replay(PcapReader &reader, MarketDataParser<Handler> &parser, double speed = 0,
+            uint16_t port = 0) {
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point wallStart;
+  uint64_t captureStart = 0;
+  bool first = true;
+
+  reader.forEach([&](const UdpDatagram &datagram) {
+    if (port != 0 && datagram.dstPort != port)
+      return;
+    if (speed > 0) {
+      if (first) {
+        wallStart = Clock::now();
+        captureStart = datagram.timestampNs;
+        first = false;
+      }
+      auto due = wallStart + std::chrono::nanoseconds(static_cast<int64_t>(
+                                 (datagram.timestampNs - captureStart) / speed));
+      while (Clock::now() < due) {
+      }
+    }
+    parser.parse(datagram.payload.data(), datagram.payload.size());
+    parser.reset(); // datagrams are self-contained
+  });
+}
+
+struct CountingHandler {
+  void onQuote(const Header &, const QuoteMessage &) { ++quotes; }
+  void onTrade(const Header &, const TradeMessage &) { ++trades; }
+  void onStockSummary(const Header &, const StockSummary &) { ++summaries; }
+
+  uint64_t quotes = 0;
+  uint64_t trades = 0;
+  uint64_t summaries = 0;
+};
+
+/// Writes a classic pcap of Ethernet/IPv4/UDP multicast frames carrying
+/// Pillar messages, 20 µs apart.
+void generateCapture(const std::string &path) {
+  std::vector<uint8_t> file;
+  auto put = [&file](const void *data, size_t size) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    file.insert(file.end(), bytes, bytes + size);
+  };
+  uint32_t fileHeader[6] = {0xA1B23C4D, 0x00040002, 0, 0, 65535, LinkEthernet};
+  put(fileHeader, sizeof(fileHeader));
+
+  std::mt19937 rng(3);
+  std::vector<uint32_t> seq(256, 0);
+  uint64_t timeNs = 1700000000ull * 1000000000ull;
+  for (uint32_t p = 0; p < 100000; ++p) {
+    std::vector<uint8_t> payload;
+    for (int m = 0; m < 6; ++m) {
+      uint32_t symbolIndex = rng() % seq.size();
+      if (m % 3 == 2) {
+        TradeMessage trade{symbolIndex, ++seq[symbolIndex], p, 42.5, 100};
+        encodeMessage(payload, MsgType::Trade, static_cast<uint32_t>(timeNs), trade);
+      } else {
+        QuoteMessage quote{symbolIndex, ++seq[symbolIndex], 42.51, 200, 42.49, 300};
+        encodeMessage(payload, MsgType::Quote, static_cast<uint32_t>(timeNs), quote);
+      }
+    }
+
+    uint8_t ethernet[14] = {0x01, 0x00, 0x5E, 0x64, 0x00, 0x01, 0x02, 0, 0, 0, 0, 1, 0x08, 0x00};
+    uint16_t udpLength = static_cast<uint16_t>(8 + payload.size());
+    uint16_t ipLength = static_cast<uint16_t>(20 + udpLength);
+    uint8_t ip[20] = {0x45, 0, static_cast<uint8_t>(ipLength >> 8), static_cast<uint8_t>(ipLength),
+                      0, 0, 0x40, 0, 1, 17, 0, 0, 10, 0, 0, 1, 239, 100, 0, 1};
+    uint8_t udp[8] = {0x75, 0x31, 0x75, 0x31, static_cast<uint8_t>(udpLength >> 8),
+                      static_cast<uint8_t>(udpLength), 0, 0};
+
+    uint32_t frameLength = static_cast<uint32_t>(sizeof(ethernet) + ipLength);
+    uint32_t record[4] = {static_cast<uint32_t>(timeNs / 1000000000ull),
+                          static_cast<uint32_t>(timeNs % 1000000000ull), frameLength,
+                          frameLength};
+    put(record, sizeof(record));
+    put(ethernet, sizeof(ethernet));
+    put(ip, sizeof(ip));
+    put(udp, sizeof(udp));
+    put(payload.data(), payload.size());
+    timeNs += 20000;
+  }
+
+  FILE *out = std::fopen(path.c_str(), "wb");
+  if (out == nullptr || std::fwrite(file.data(), 1, file.size(), out) != file.size())
+    throw std::runtime_error("cannot write " + path);
+  std::fclose(out);
+}
+
+int usage(const char *program) {
+  std::fprintf(stderr, "usage: %s <capture> [--paced] [--speed X] [--port N]\n"
+                       "       %s --generate <out.pcap>\n", program, program);
+  return 1;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2)
+    return usage(argv[0]);
+  if (std::string(argv[1]) == "--generate" && argc == 3) {
+    generateCapture(argv[2]);
+    return 0;
+  }
+
+  double speed = 0;
+  uint16_t port = 0;
+  for (int i = 2; i < argc; ++i) {
+    std::string arg = argv[i];
+    try {
+      if (arg == "--paced") {
+        if (speed == 0)
+          speed = 1.0;
+      } else if (arg == "--speed" && i + 1 < argc) {
+        speed = std::stod(argv[++i]);
+        if (!(speed > 0))
+          throw std::out_of_range("speed");
+      } else if (arg == "--port" && i + 1 < argc) {
+        unsigned long value = std::stoul(argv[++i]);
+        if (value == 0 || value > 65535)
+          throw std::out_of_range("port");
+        port = static_cast<uint16_t>(value);
+      } else {
+        std::fprintf(stderr, "unknown argument: %s\n", arg.c_str());
+        return usage(argv[0]);
+      }
+    } catch (const std::logic_error &) { // invalid_argument, out_of_range
+      std::fprintf(stderr, "invalid value for %s: %s\n", arg.c_str(), argv[i]);
+      return usage(argv[0]);
+    }
+  }
+
+  PcapReader reader(argv[1]);
+  CountingHandler handler;
+  MarketDataParser<CountingHandler> parser(handler);
+
+  auto start = std::chrono::steady_clock::now();
+  replay(reader, parser, speed, port);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  const PcapStats &stats = reader.stats();
+  std::printf("frames: %llu, datagrams: %llu, skipped: %llu, truncated: %llu\n",
+              static_cast<unsigned long long>(stats.frames),
+              static_cast<unsigned long long>(stats.datagrams),
+              static_cast<unsigned long long>(stats.skipped),
+              static_cast<unsigned long long>(stats.truncated));
+  std::printf("quotes: %llu, trades: %llu, summaries: %llu, malformed: %llu in %.3f s "
+              "(%.1f M datagrams/s)\n",
+              static_cast<unsigned long long>(handler.quotes),
+              static_cast<unsigned long long>(handler.trades),
+              static_cast<unsigned long long>(handler.summaries),
+              static_cast<unsigned long long>(parser.stats().malformed), elapsed.count(),
+              stats.datagrams / elapsed.count() / 1e6);
+  return 0;
+}
@@ -0,0 +1,210 @@
+// Build: g++ -std=c++20 -O2 -march=native -pthread quote_cache.cpp
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "market_data_parser.h"
+
+/**
+ * Top-of-book quote cache keyed by symbolIndex.
+ *
+ * One cache line per symbol, in a dense array indexed by symbolIndex, holds
+ * the latest QuoteMessage and its sourceTime. The parser thread is the only
+ * writer and updates entries in place as a MarketDataParser handler; any
+ * number of reader threads take snapshots through a per-entry seqlock:
+ * - the writer makes `sequence` odd, stores the payload, makes it even,
+ * - a reader copies the payload between two loads of `sequence` and retries
+ *   if they differ or are odd, so it never returns a half-written quote.
+ * A lookup is one indexed load of one line; readers never write shared
+ * memory, so they do not slow the writer or each other down.
+ *
+ * The payload is stored as relaxed atomic words rather than a plain struct,
+ * which keeps the concurrent copy free of data races in the C++ model while
+ * compiling to ordinary moves.
+ */
+
+struct QuoteSnapshot {
+  uint32_t sourceTime;
+  QuoteMessage quote;
+};
+
+class QuoteCache {
+public:
+  explicit QuoteCache(size_t symbolCount) : entries(symbolCount) {}
+
+  // MarketDataParser handler interface: the parser updates the cache in place.
+  // A quote for a symbolIndex outside the cache is dropped and counted.
+  void onQuote(const Header &header, const QuoteMessage &quote) {
+    if (quote.symbolIndex < entries.size())
+      store(quote.symbolIndex, QuoteSnapshot{header.sourceTime, quote});
+    else
+      ++unknownSymbols;
+  }
+  void onTrade(const Header &, const TradeMessage &) {}
+  void onStockSummary(const Header &, const StockSummary &) {}
+
+  /// Single writer only.
+  void store(uint32_t symbolIndex, const QuoteSnapshot &snapshot) {
+    Entry &entry = entries[symbolIndex];
+    uint64_t words[PayloadWords] = {};
+    std::memcpy(words, &snapshot, sizeof(QuoteSnapshot));
+
+    uint32_t sequence = entry.sequence.load(std::memory_order_relaxed);
+    entry.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < PayloadWords; ++i)
+      entry.payload[i].store(words[i], std::memory_order_relaxed);
+    entry.sequence.store(sequence + 2, std::memory_order_release);
+  }
+
+  /// Any thread. Returns false if the symbol has never been quoted, or is
+  /// outside the cache.
+  bool load(uint32_t symbolIndex, QuoteSnapshot &snapshot) const {
+    if (symbolIndex >= entries.size())
+      return false;
+    const Entry &entry = entries[symbolIndex];
+    uint64_t words[PayloadWords];
+    uint32_t before;
+    uint32_t after;
+    do {
+      before = entry.sequence.load(std::memory_order_acquire);
+      for (size_t i = 0; i < PayloadWords; ++i)
+        words[i] = entry.payload[i].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = entry.sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+
+    if (before == 0)
+      return false;
+    std::memcpy(&snapshot, words, sizeof(QuoteSnapshot));
+    return true;
+  }
+
+  uint64_t unknownSymbols = 0; // written by the parser thread only
+
+private:
+  static constexpr size_t PayloadWords = (sizeof(QuoteSnapshot) + 7) / 8;
+
+  struct alignas(64) Entry {
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<uint64_t> payload[PayloadWords] = {};
+  };
+  static_assert(sizeof(Entry) == 64, "one cache line per symbol");
+
+  std::vector<Entry> entries;
+};
+
+/// The pattern strategies use today, for comparison.
+class LockedQuoteMap {
+public:
+  void onQuote(const Header &header, const QuoteMessage &quote) {
+    std::lock_guard<std::mutex> lock(mutex);
+    quotes[quote.symbolIndex] = QuoteSnapshot{header.sourceTime, quote};
+  }
+  void onTrade(const Header &, const TradeMessage &) {}
+  void onStockSummary(const Header &, const StockSummary &) {}
+
+  bool load(uint32_t symbolIndex, QuoteSnapshot &snapshot) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = quotes.find(symbolIndex);
+    if (it == quotes.end())
+      return false;
+    snapshot = it->second;
+    return true;
+  }
+
+private:
+  mutable std::mutex mutex;
+  std::unordered_map<uint32_t, QuoteSnapshot> quotes;
+};
+
+/**
+ * Every field of a generated quote is derived from its symbolSeqNum, so a
+ * reader can tell a torn snapshot (fields from two different updates).
+ */
+QuoteMessage makeQuote(uint32_t symbolIndex, uint32_t seq) {
+  return QuoteMessage{symbolIndex, seq, seq + 0.5, seq, seq - 0.5, seq};
+}
+
+bool consistent(const QuoteSnapshot &snapshot) {
+  const QuoteMessage &q = snapshot.quote;
+  uint32_t seq = q.symbolSeqNum;
+  return q.askPrice == seq + 0.5 && q.bidPrice == seq - 0.5 && q.askVolume == seq &&
+         q.bidVolume == seq && snapshot.sourceTime == seq;
+}
+
+template <typename Cache>
+void run(const char *name, Cache &cache, size_t symbolCount, size_t readerCount) {
+  // The writer replays a prebuilt quote stream through the parser, over and
+  // over, while the readers look up random symbols.
+  std::vector<uint8_t> stream;
+  std::vector<uint32_t> seq(symbolCount, 0);
+  std::mt19937 rng(9);
+  for (size_t m = 0; m < 100000; ++m) {
+    uint32_t symbolIndex = rng() % symbolCount;
+    uint32_t s = ++seq[symbolIndex];
+    encodeMessage(stream, MsgType::Quote, s, makeQuote(symbolIndex, s));
+  }
+
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> reads{0};
+  std::atomic<uint64_t> torn{0};
+  std::atomic<uint64_t> writes{0};
+
+  std::thread writer([&] {
+    MarketDataParser<Cache> parser(cache);
+    while (!stop.load(std::memory_order_relaxed)) {
+      parser.parse(stream);
+      writes.fetch_add(100000, std::memory_order_relaxed);
+    }
+  });
+
+  std::vector<std::thread> readers;
+  for (size_t r = 0; r < readerCount; ++r) {
+    readers.emplace_back([&, r] {
+      std::mt19937 local(static_cast<uint32_t>(r));
+      uint64_t count = 0;
+      uint64_t bad = 0;
+      QuoteSnapshot snapshot;
+      while (!stop.load(std::memory_order_relaxed)) {
+        for (int i = 0; i < 1024; ++i) {
+          if (cache.load(local() % symbolCount, snapshot) && !consistent(snapshot))
+            ++bad;
+        }
+        count += 1024;
+      }
+      reads.fetch_add(count);
+      torn.fetch_add(bad);
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+  stop.store(true);
+  writer.join();
+  for (std::thread &reader : readers)
+    reader.join();
+
+  std::printf("%-20s %6.1f M reads/s  %6.1f M writes/s  torn: %llu\n", name, reads.load() / 1e6,
+              writes.load() / 1e6, static_cast<unsigned long long>(torn.load()));
+}
+
+int main() {
+  constexpr size_t symbolCount = 8192;
+  size_t readerCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+  std::printf("1 writer, %zu readers, %zu symbols\n", readerCount, symbolCount);
+
+  QuoteCache cache(symbolCount);
+  run("seqlock cache", cache, symbolCount, readerCount);
+
+  LockedQuoteMap locked;
+  run("mutex + hashmap", locked, symbolCount, readerCount);
+  return 0;
+}
@@ -0,0 +1,408 @@
+// Build: g++ -std=c++20 -O2 -march=native -pthread udp_feed_simulator.cpp
+//
+// Usage: udp_feed_simulator [loopback|publish|receive] [--rate msgs/s]
+//          [--seconds N] [--messages-per-packet N] [--busy-poll]
+//          [--group 239.100.0.1] [--port 30001] [--latency-csv FILE]
+//
+// If multicast does not reach the receiver, enable it on lo:
+//   ip link set lo multicast on
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "market_data_parser.h"
+
+/**
+ * Loopback UDP multicast feed simulator and receiver.
+ *
+ * The publisher packs Pillar-format messages (Header + Quote/Trade body)
+ * into datagrams and paces them to a target message rate. Header::sourceTime
+ * carries the low 32 bits of CLOCK_REALTIME in nanoseconds at send time.
+ *
+ * The receiver drains the socket with recvmmsg in batches, asks the kernel
+ * for a receive timestamp per datagram (SO_TIMESTAMPNS) and runs every
+ * datagram through MarketDataParser. At the end it reports packets/sec and
+ * two latencies measured at the parser callback:
+ * - wire-to-callback: kernel receive timestamp -> callback,
+ * - source-to-callback: publisher's sourceTime -> callback.
+ * Each batch is also stamped on receipt (ReceiveStamp), so the parser's own
+ * source-to-parse histogram is printed alongside, and with --latency-csv it
+ * is exported as CSV.
+ *
+ * With --busy-poll the receiver sets SO_BUSY_POLL and polls with
+ * MSG_DONTWAIT instead of sleeping in the kernel.
+ */
+
+struct Options {
+  std::string mode = "loopback";
+  std::string group = "239.100.0.1";
+  in_addr groupAddress{}; // `group`, parsed and checked by parseOptions
+  uint16_t port = 30001;
+  uint64_t rate = 1000000; // messages per second
+  uint32_t seconds = 3;
+  uint32_t messagesPerPacket = 8;
+  bool busyPoll = false;
+  std::string latencyCsv;
+};
+
+[[noreturn]] void fail(const char *what) {
+  std::perror(what);
+  std::exit(1);
+}
+
+class MulticastPublisher {
+public:
+  explicit MulticastPublisher(const Options &options) : options(options) {
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+      fail("socket");
+
+    in_addr loopback{htonl(INADDR_LOOPBACK)};
+    if (setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &loopback, sizeof(loopback)) < 0)
+      fail("IP_MULTICAST_IF");
+    unsigned char loop = 1;
+    if (setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0)
+      fail("IP_MULTICAST_LOOP");
+
+    destination.sin_family = AF_INET;
+    destination.sin_port = htons(options.port);
+    destination.sin_addr = options.groupAddress;
+  }
+
+  ~MulticastPublisher() { close(fd); }
+
+  /// Sends until `seconds` have elapsed, pacing packets to `rate` messages/s.
+  uint64_t run() {
+    constexpr uint32_t symbolCount = 1024;
+    std::mt19937 rng(1);
+    std::vector<uint32_t> seq(symbolCount, 0);
+    std::vector<uint8_t> packet;
+    packet.reserve(options.messagesPerPacket * (sizeof(Header) + sizeof(QuoteMessage)));
+
+    using Clock = std::chrono::steady_clock;
+    auto interval = std::chrono::nanoseconds(
+        1000000000ull * options.messagesPerPacket / options.rate);
+    auto start = Clock::now();
+    auto end = start + std::chrono::seconds(options.seconds);
+    auto next = start;
+    uint64_t packets = 0;
+    uint32_t tradeID = 0;
+
+    while (next < end) {
+      while (Clock::now() < next) {
+      }
+
+      packet.clear();
+      uint32_t sourceTime = static_cast<uint32_t>(wallClockNs());
+      for (uint32_t m = 0; m < options.messagesPerPacket; ++m) {
+        uint32_t symbolIndex = rng() % symbolCount;
+        if (rng() % 4 == 0) {
+          TradeMessage trade{symbolIndex, ++seq[symbolIndex], ++tradeID, 100.25, 100};
+          encodeMessage(packet, MsgType::Trade, sourceTime, trade);
+        } else {
+          QuoteMessage quote{symbolIndex, ++seq[symbolIndex], 100.26, 200, 100.24, 300};
+          encodeMessage(packet, MsgType::Quote, sourceTime, quote);
+        }
+      }
+
+      if (sendto(fd, packet.data(), packet.size(), 0,
+                 reinterpret_cast<const sockaddr *>(&destination),
+                 sizeof(destination)) < 0)
+        fail("sendto");
+      ++packets;
+      next += interval;
+    }
+    return packets;
+  }
+
+private:
+  const Options &options;
+  int fd = -1;
+  sockaddr_in destination{};
+};
+
+/**
+ * Parser handler of the receiver. Latencies go into fixed-size histograms,
+ * so the callback never allocates and memory does not grow with the rate
+ * or the length of the run.
+ */
+class LatencyRecorder {
+public:
+  void setReceiveTime(uint64_t kernelNs) { receiveNs = kernelNs; }
+
+  void onQuote(const Header &header, const QuoteMessage &) { record(header); }
+  void onTrade(const Header &header, const TradeMessage &) { record(header); }
+  void onStockSummary(const Header &header, const StockSummary &) { record(header); }
+
+  LatencyHistogram wireToCallback;
+  LatencyHistogram sourceToCallback;
+
+private:
+  void record(const Header &header) {
+    uint64_t now = wallClockNs();
+    if (receiveNs != 0)
+      wireToCallback.record(static_cast<int64_t>(now - receiveNs));
+    // sourceTime is the low 32 bits of the send time; the signed 32-bit
+    // difference is correct across a 2^32 ns boundary.
+    sourceToCallback.record(static_cast<int32_t>(static_cast<uint32_t>(now) - header.sourceTime));
+  }
+
+  uint64_t receiveNs = 0;
+};
+
+struct ReceiverStats {
+  uint64_t packets = 0;
+  uint64_t batches = 0;
+  uint64_t truncated = 0; // datagram ended mid-message
+};
+
+class MulticastReceiver {
+public:
+  static constexpr unsigned BatchSize = 64;
+  static constexpr size_t DatagramSize = 2048;
+
+  explicit MulticastReceiver(const Options &options) : options(options) {
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+      fail("socket");
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof(one)) < 0)
+      fail("SO_TIMESTAMPNS");
+    int bufferSize = 16 * 1024 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+    if (options.busyPoll) {
+      int busyPollUs = 50;
+      if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &busyPollUs, sizeof(busyPollUs)) < 0)
+        std::perror("SO_BUSY_POLL (continuing with user-space polling only)");
+    }
+
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_port = htons(options.port);
+    local.sin_addr = options.groupAddress;
+    if (bind(fd, reinterpret_cast<const sockaddr *>(&local), sizeof(local)) < 0)
+      fail("bind");
+
+    ip_mreq membership{};
+    membership.imr_multiaddr = options.groupAddress;
+    membership.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+    if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0)
+      fail("IP_ADD_MEMBERSHIP");
+
+    // A 200 ms timeout lets the blocking receiver notice `stop`.
+    timeval timeout{0, 200000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    for (unsigned i = 0; i < BatchSize; ++i) {
+      iovecs[i] = {datagrams[i], DatagramSize};
+      headers[i].msg_hdr.msg_iov = &iovecs[i];
+      headers[i].msg_hdr.msg_iovlen = 1;
+    }
+  }
+
+  ~MulticastReceiver() { close(fd); }
+
+  template <typename Handler>
+  void run(MarketDataParser<Handler> &parser, LatencyRecorder &recorder,
+           const std::atomic<bool> &stop) {
+    int flags = options.busyPoll ? MSG_DONTWAIT : MSG_WAITFORONE;
+    while (!stop.load(std::memory_order_relaxed)) {
+      for (unsigned i = 0; i < BatchSize; ++i) {
+        headers[i].msg_hdr.msg_control = controls[i];
+        headers[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+      }
+
+      int received = recvmmsg(fd, headers, BatchSize, flags, nullptr);
+      if (received < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+          continue;
+        fail("recvmmsg");
+      }
+
+      ++stats_.batches;
+      ReceiveStamp stamp = ReceiveStamp::now();
+      for (int i = 0; i < received; ++i) {
+        recorder.setReceiveTime(kernelTimestamp(headers[i].msg_hdr));
+        parser.parse(datagrams[i], headers[i].msg_len, stamp);
+        // Datagrams are self-contained; never stitch across them.
+        if (parser.pendingBytes() != 0) {
+          ++stats_.truncated;
+          parser.reset();
+        }
+      }
+      stats_.packets += received;
+    }
+  }
+
+  const ReceiverStats &stats() const { return stats_; }
+
+private:
+  static uint64_t kernelTimestamp(const msghdr &header) {
+    for (cmsghdr *cmsg = CMSG_FIRSTHDR(&header); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(const_cast<msghdr *>(&header), cmsg)) {
+      if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+        timespec stamp;
+        std::memcpy(&stamp, CMSG_DATA(cmsg), sizeof(stamp));
+        return static_cast<uint64_t>(stamp.tv_sec) * 1000000000ull + stamp.tv_nsec;
+      }
+    }
+    return 0;
+  }
+
+  const Options &options;
+  int fd = -1;
+  alignas(64) uint8_t datagrams[BatchSize][DatagramSize];
+  alignas(64) char controls[BatchSize][CMSG_SPACE(sizeof(timespec))];
+  iovec iovecs[BatchSize];
+  mmsghdr headers[BatchSize]{};
+  ReceiverStats stats_;
+};
+
+Options parseOptions(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    auto value = [&] {
+      if (i + 1 >= argc) {
+        std::fprintf(stderr, "missing value for %s\n", arg.c_str());
+        std::exit(1);
+      }
+      return std::string(argv[++i]);
+    };
+    // A whole, non-negative decimal number no larger than `max`.
+    auto number = [&](uint64_t max) {
+      std::string text = value();
+      size_t used = 0;
+      uint64_t parsed = 0;
+      try {
+        if (!text.empty() && text[0] != '-')
+          parsed = std::stoull(text, &used);
+      } catch (const std::logic_error &) { // invalid_argument, out_of_range
+        used = 0;
+      }
+      if (used == 0 || used != text.size() || parsed > max) {
+        std::fprintf(stderr, "invalid value for %s: %s\n", arg.c_str(), text.c_str());
+        std::exit(1);
+      }
+      return parsed;
+    };
+    if (arg == "loopback" || arg == "publish" || arg == "receive")
+      options.mode = arg;
+    else if (arg == "--rate")
+      options.rate = number(UINT64_MAX);
+    else if (arg == "--seconds")
+      options.seconds = static_cast<uint32_t>(number(UINT32_MAX));
+    else if (arg == "--messages-per-packet")
+      options.messagesPerPacket = static_cast<uint32_t>(number(UINT32_MAX));
+    else if (arg == "--busy-poll")
+      options.busyPoll = true;
+    else if (arg == "--group")
+      options.group = value();
+    else if (arg == "--port")
+      options.port = static_cast<uint16_t>(number(UINT16_MAX));
+    else if (arg == "--latency-csv")
+      options.latencyCsv = value();
+    else {
+      std::fprintf(stderr, "unknown argument: %s\n", arg.c_str());
+      std::exit(1);
+    }
+  }
+
+  size_t largestMessage = sizeof(Header) + std::max(sizeof(QuoteMessage), sizeof(TradeMessage));
+  const char *invalid = nullptr;
+  if (inet_pton(AF_INET, options.group.c_str(), &options.groupAddress) != 1 ||
+      !IN_MULTICAST(ntohl(options.groupAddress.s_addr)))
+    invalid = "--group must be an IPv4 multicast address (224.0.0.0/4)";
+  else if (options.port == 0)
+    invalid = "--port must be 1-65535";
+  else if (options.rate == 0)
+    invalid = "--rate must be at least 1";
+  else if (options.seconds == 0)
+    invalid = "--seconds must be at least 1";
+  else if (options.messagesPerPacket == 0 ||
+           options.messagesPerPacket * largestMessage > MulticastReceiver::DatagramSize)
+    invalid = "--messages-per-packet must fit one datagram";
+  if (invalid != nullptr) {
+    std::fprintf(stderr, "%s\n", invalid);
+    std::exit(1);
+  }
+  return options;
+}
+
+int main(int argc, char **argv) {
+  Options options = parseOptions(argc, argv);
+  std::atomic<bool> stop{false};
+
+  if (options.mode == "publish") {
+    MulticastPublisher publisher(options);
+    uint64_t packets = publisher.run();
+    std::printf("sent %llu packets\n", static_cast<unsigned long long>(packets));
+    return 0;
+  }
+
+  // The receiver is large (datagram and control buffers); keep it off the stack.
+  auto receiver = std::make_unique<MulticastReceiver>(options);
+  // Two histograms of ~15 KiB each; also off the stack.
+  auto recorder = std::make_unique<LatencyRecorder>();
+  MarketDataParser<LatencyRecorder> parser(*recorder);
+
+  std::thread publisherThread;
+  if (options.mode == "loopback") {
+    publisherThread = std::thread([&] {
+      MulticastPublisher publisher(options);
+      uint64_t packets = publisher.run();
+      std::printf("sent %llu packets\n", static_cast<unsigned long long>(packets));
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      stop.store(true);
+    });
+  } else {
+    std::thread([&] {
+      std::this_thread::sleep_for(std::chrono::seconds(options.seconds));
+      stop.store(true);
+    }).detach();
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  receiver->run(parser, *recorder, stop);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  if (publisherThread.joinable())
+    publisherThread.join();
+
+  const ReceiverStats &stats = receiver->stats();
+  std::printf("received %llu packets, %llu messages in %.2f s: %.0f packets/s, "
+              "%.1f packets/batch, truncated: %llu\n",
+              static_cast<unsigned long long>(stats.packets),
+              static_cast<unsigned long long>(parser.stats().messages),
+              elapsed.count(), stats.packets / elapsed.count(),
+              stats.batches ? static_cast<double>(stats.packets) / stats.batches : 0.0,
+              static_cast<unsigned long long>(stats.truncated));
+  recorder->wireToCallback.print(stdout, "wire-to-callback");
+  recorder->sourceToCallback.print(stdout, "source-to-callback");
+  parser.latency().print(stdout, "source-to-parse");
+  if (!options.latencyCsv.empty()) {
+    std::FILE *csv = std::fopen(options.latencyCsv.c_str(), "w");
+    if (!csv)
+      fail(options.latencyCsv.c_str());
+    parser.latency().exportCsv(csv);
+    std::fclose(csv);
+  }
+  return 0;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <thread>
+
+#include "cpu_affinity.h"
+#include "tsc.h"
+
+/**
+ * Retries `attempt` until it succeeds. Benchmarks measure spinning, so it
+ * spins, but yields after a few thousand failures so a run still finishes
+ * when there are more threads than cores; with a single core it yields on
+ * every failure.
+ */
+template <typename Attempt>
+void spinUntil(Attempt attempt) {
+    static const unsigned spinLimit = std::thread::hardware_concurrency() < 2 ? 0 : 4096;
+    for (unsigned spins = 0; !attempt(); ++spins) {
+        if (spins >= spinLimit) {
+            std::this_thread::yield();
+            spins = 0;
+        }
+    }
+}
@@ -0,0 +1,178 @@
+// Build: g++ -std=c++20 -O2 -march=native -pthread broadcast_benchmark.cpp -o broadcast_benchmark
+// Usage: broadcast_benchmark [maxConsumers]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "benchmark_support.h"
+#include "broadcast_queue.h"
+#include "queue.h"
+
+/**
+ * Fan-out benchmark for the broadcast ring.
+ * - fan-out: one producer delivers `Items` events to 1..N consumers, through
+ *   one BroadcastQueue (written once) and through one LockFreeQueue per
+ *   consumer (written N times); reports delivered events per consumer per
+ *   second. Every consumer checks that it saw every event in order.
+ * - overwrite: a fast and a stalling consumer on an Overwrite ring; the
+ *   producer never waits, the fast consumer sees every event, and the
+ *   stalling one reports how many it skipped instead of holding both up.
+ */
+
+struct Event {
+    uint64_t seq;
+    uint64_t instrument;
+    double bid;
+    double ask;
+};
+
+constexpr size_t RingSize = 4096;
+constexpr size_t MaxConsumers = 16;
+constexpr uint64_t Items = 4'000'000;
+
+void checkSequence(const Event& event, uint64_t expected) {
+    if (event.seq != expected) {
+        std::fprintf(stderr, "consumer expected %llu, got %llu\n",
+                     static_cast<unsigned long long>(expected),
+                     static_cast<unsigned long long>(event.seq));
+        std::exit(1);
+    }
+}
+
+double broadcastPerSecond(size_t consumers) {
+    using Ring = BroadcastQueue<Event, RingSize, MaxConsumers>;
+    auto ring = std::make_unique<Ring>();
+    std::vector<std::thread> threads;
+    for (size_t c = 0; c < consumers; ++c) {
+        // Consumers start at the position current when they subscribe.
+        threads.emplace_back([&, consumer = *ring->subscribe()]() mutable {
+            Event event;
+            for (uint64_t i = 0; i < Items; ++i) {
+                spinUntil([&] { return consumer.poll(event); });
+                checkSequence(event, i);
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < Items; ++i) {
+        Event event{i, i & 255, 99.99, 100.01};
+        spinUntil([&] { return ring->publish(event); });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return Items / elapsed.count();
+}
+
+double queuesPerSecond(size_t consumers) {
+    std::vector<std::unique_ptr<LockFreeQueue<Event, RingSize>>> queues;
+    for (size_t c = 0; c < consumers; ++c) {
+        queues.push_back(std::make_unique<LockFreeQueue<Event, RingSize>>());
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t c = 0; c < consumers; ++c) {
+        threads.emplace_back([&, c] {
+            Event event;
+            for (uint64_t i = 0; i < Items; ++i) {
+                spinUntil([&] { return queues[c]->dequeue(event); });
+                checkSequence(event, i);
+            }
+        });
+    }
+    for (uint64_t i = 0; i < Items; ++i) {
+        Event event{i, i & 255, 99.99, 100.01};
+        for (auto& queue : queues) {
+            spinUntil([&] { return queue->enqueue(event); });
+        }
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return Items / elapsed.count();
+}
+
+void overwrite() {
+    using Ring = BroadcastQueue<Event, RingSize, MaxConsumers, SlowConsumer::Overwrite>;
+    auto ring = std::make_unique<Ring>();
+    std::atomic<bool> done{false};
+
+    auto consume = [&](Ring::Consumer consumer, bool stall, const char* name) {
+        Event event;
+        uint64_t received = 0;
+        uint64_t last = 0;
+        for (;;) {
+            // Read `done` first: once it is set, one more empty poll means
+            // the consumer has seen everything.
+            bool finished = done.load(std::memory_order_acquire);
+            if (!consumer.poll(event)) {
+                if (finished) {
+                    break;
+                }
+                std::this_thread::yield();
+                continue;
+            }
+            if (received != 0 && event.seq <= last) {
+                std::fprintf(stderr, "%s consumer went backwards at %llu\n", name,
+                             static_cast<unsigned long long>(event.seq));
+                std::exit(1);
+            }
+            last = event.seq;
+            ++received;
+            if (stall && received % 100'000 == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+        }
+        std::printf("  %-8s received %9llu, skipped %9llu\n", name,
+                    static_cast<unsigned long long>(received),
+                    static_cast<unsigned long long>(consumer.lost()));
+    };
+
+    std::thread fast([&, consumer = *ring->subscribe()]() mutable {
+        consume(std::move(consumer), false, "fast");
+    });
+    std::thread slow([&, consumer = *ring->subscribe()]() mutable {
+        consume(std::move(consumer), true, "stalling");
+    });
+
+    // The feed arrives in bursts of 256 events; between bursts the producer
+    // gives up its core, so a consumer sharing it can keep up.
+    for (uint64_t i = 0; i < Items; ++i) {
+        ring->publish(Event{i, i & 255, 99.99, 100.01});
+        if ((i & 255) == 255) {
+            std::this_thread::yield();
+        }
+    }
+    done.store(true, std::memory_order_release);
+    fast.join();
+    slow.join();
+}
+
+int main(int argc, char** argv) {
+    size_t maxConsumers = argc > 1 ? std::strtoul(argv[1], nullptr, 10)
+                                   : std::max(4u, std::thread::hardware_concurrency());
+    maxConsumers = std::min(maxConsumers, MaxConsumers);
+    std::printf("%u hardware threads, %llu events per run, M events/s to every consumer:\n",
+                std::thread::hardware_concurrency(), static_cast<unsigned long long>(Items));
+    std::printf("%-10s %12s %14s\n", "consumers", "broadcast", "SPSC queues");
+    for (size_t consumers = 1; consumers <= maxConsumers; ++consumers) {
+        double broadcast = broadcastPerSecond(consumers);
+        double queues = queuesPerSecond(consumers);
+        std::printf("%-10zu %12.1f %14.1f\n", consumers, broadcast / 1e6, queues / 1e6);
+    }
+    std::printf("overwrite, %zu-slot ring, one consumer stalling 2 ms every 100k events:\n",
+                RingSize);
+    overwrite();
+    return 0;
+}
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <type_traits>
+
+#include "queue.h"
+
+enum class SlowConsumer {
+    Block,     // the producer waits for the slowest consumer
+    Overwrite, // the producer never waits; a consumer that falls a lap behind skips ahead
+};
+
+/**
+ * One producer, up to `MaxConsumers` independent consumers, one copy of
+ * each item (a disruptor-style broadcast ring).
+ *
+ * The producer writes each item once and advances `published`. Each consumer
+ * owns a read cursor on its own cache line and sees every item, so adding a
+ * consumer adds no work to the producer's hot path:
+ * - Block: the producer may not lap the slowest cursor. It keeps a cached
+ *   copy of the minimum cursor and rescans the cursors only when that copy
+ *   says the ring is full.
+ * - Overwrite: the producer ignores the cursors. Every slot has a seqlock-
+ *   style sequence; a consumer that finds its slot rewritten by a later lap
+ *   jumps to the oldest item still in the ring and counts what it missed in
+ *   `lost()`, so one stalled strategy cannot hold up the feed.
+ * T must be trivially copyable. In Overwrite mode an item may be read while
+ * it is being replaced (the copy is then discarded), so slots hold it as
+ * relaxed atomic words, as QuoteCache does, which keeps that overlap free of
+ * data races while compiling to ordinary moves.
+ */
+template <typename T, size_t Size, size_t MaxConsumers, SlowConsumer Policy = SlowConsumer::Block>
+class BroadcastQueue {
+    static_assert(Size >= 2 && (Size & (Size - 1)) == 0, "Size must be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+    /// A consumer's view of the ring; use from one thread.
+    class Consumer {
+    public:
+        Consumer(Consumer&& other) noexcept
+            : ring(other.ring), id(other.id), next(other.next), cachedPublished(other.cachedPublished),
+              lost_(other.lost_) {
+            other.ring = nullptr;
+        }
+        Consumer& operator=(Consumer&&) = delete;
+        Consumer(const Consumer&) = delete;
+
+        ~Consumer() {
+            if (ring != nullptr) {
+                ring->cursors[id].active.store(false, std::memory_order_release);
+            }
+        }
+
+        /// Copies the next item into `item`; false if the consumer is caught up.
+        bool poll(T& item) {
+            for (;;) {
+                if (next == cachedPublished) {
+                    cachedPublished = ring->published.load(std::memory_order_acquire);
+                    if (next == cachedPublished) {
+                        return false;
+                    }
+                }
+                Slot& slot = ring->slots[next & Mask];
+                if constexpr (Policy == SlowConsumer::Block) {
+                    item = slot.value;
+                    ++next;
+                    ring->cursors[id].position.store(next, std::memory_order_release);
+                    return true;
+                } else {
+                    uint64_t words[PayloadWords];
+                    uint64_t before = slot.sequence.load(std::memory_order_acquire);
+                    for (size_t i = 0; i < PayloadWords; ++i) {
+                        words[i] = slot.payload[i].load(std::memory_order_relaxed);
+                    }
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    uint64_t after = slot.sequence.load(std::memory_order_relaxed);
+                    if (before == after && before == written(next)) {
+                        std::memcpy(&item, words, sizeof(T));
+                        ++next;
+                        return true;
+                    }
+                    // Lapped: resume at the oldest item the producer cannot
+                    // be rewriting yet.
+                    uint64_t published = ring->published.load(std::memory_order_acquire);
+                    uint64_t resume = published > Size - 1 ? published - (Size - 1) : 0;
+                    lost_ += resume - next;
+                    next = resume;
+                    cachedPublished = published;
+                }
+            }
+        }
+
+        /// Items skipped because the producer lapped this consumer (Overwrite).
+        uint64_t lost() const { return lost_; }
+
+    private:
+        friend class BroadcastQueue;
+
+        Consumer(BroadcastQueue* ring, size_t id, uint64_t start)
+            : ring(ring), id(id), next(start), cachedPublished(start) {}
+
+        BroadcastQueue* ring;
+        size_t id;
+        uint64_t next;
+        uint64_t cachedPublished;
+        uint64_t lost_ = 0;
+    };
+
+    BroadcastQueue() {
+        if constexpr (Policy == SlowConsumer::Overwrite) {
+            for (Slot& slot : slots) {
+                slot.sequence.store(UINT64_MAX, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    BroadcastQueue(const BroadcastQueue&) = delete;
+    BroadcastQueue& operator=(const BroadcastQueue&) = delete;
+
+    /**
+     * Registers a consumer that sees every item published from now on. Any
+     * thread; empty if all `MaxConsumers` cursors are taken. Destroying the
+     * Consumer frees its cursor.
+     */
+    std::optional<Consumer> subscribe() {
+        for (size_t id = 0; id < MaxConsumers; ++id) {
+            bool inactive = false;
+            if (!cursors[id].active.compare_exchange_strong(inactive, true,
+                                                            std::memory_order_acq_rel)) {
+                continue;
+            }
+            // Store-load against the producer's rescan: with a full fence
+            // here and at the top of `minimumCursor`, either the rescan sees
+            // this cursor active, or this load sees every position the
+            // producer published before that rescan, so the minimum it
+            // computed without us is at most `start` and it cannot lap
+            // `start` before its next rescan, which will see us. Until the
+            // position store below, the producer may read a stale (older)
+            // position and wait for nothing, never the reverse.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            uint64_t start = published.load(std::memory_order_acquire);
+            cursors[id].position.store(start, std::memory_order_release);
+            return Consumer(this, id, start);
+        }
+        return std::nullopt;
+    }
+
+    /// Producer only. Block: false while the slowest consumer is a lap behind.
+    bool publish(const T& item) {
+        uint64_t position = published.load(std::memory_order_relaxed);
+        Slot& slot = slots[position & Mask];
+        if constexpr (Policy == SlowConsumer::Block) {
+            if (position - cachedMinimum >= Size) {
+                cachedMinimum = minimumCursor(position);
+                if (position - cachedMinimum >= Size) {
+                    return false;
+                }
+            }
+            slot.value = item;
+        } else {
+            uint64_t words[PayloadWords] = {};
+            std::memcpy(words, &item, sizeof(T));
+            slot.sequence.store(writing(position), std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (size_t i = 0; i < PayloadWords; ++i) {
+                slot.payload[i].store(words[i], std::memory_order_relaxed);
+            }
+            slot.sequence.store(written(position), std::memory_order_release);
+        }
+        published.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    static constexpr uint64_t Mask = Size - 1;
+
+    static constexpr uint64_t writing(uint64_t position) { return 2 * position + 1; }
+    static constexpr uint64_t written(uint64_t position) { return 2 * position + 2; }
+
+    static constexpr size_t PayloadWords = (sizeof(T) + 7) / 8;
+
+    struct BlockSlot {
+        T value;
+    };
+
+    struct OverwriteSlot {
+        std::atomic<uint64_t> sequence;
+        std::atomic<uint64_t> payload[PayloadWords];
+    };
+
+    using Slot = std::conditional_t<Policy == SlowConsumer::Block, BlockSlot, OverwriteSlot>;
+
+    struct alignas(CacheLineSize) Cursor {
+        std::atomic<uint64_t> position{0};
+        std::atomic<bool> active{false};
+    };
+
+    /// Rare (once per lap at most), so its full fence costs little; see
+    /// `subscribe` for why it is needed.
+    uint64_t minimumCursor(uint64_t position) const {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t minimum = position;
+        for (const Cursor& cursor : cursors) {
+            if (cursor.active.load(std::memory_order_acquire)) {
+                uint64_t at = cursor.position.load(std::memory_order_acquire);
+                minimum = at < minimum ? at : minimum;
+            }
+        }
+        return minimum;
+    }
+
+    // Producer line.
+    alignas(CacheLineSize) std::atomic<uint64_t> published{0};
+    uint64_t cachedMinimum = 0;
+
+    std::array<Cursor, MaxConsumers> cursors;
+    alignas(CacheLineSize) std::array<Slot, Size> slots;
+};
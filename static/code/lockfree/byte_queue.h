@@ -0,0 +1,185 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+
+#include "queue.h"
+
+/**
+ * Single-producer / single-consumer ring of variable-length byte records.
+ *
+ * LockFreeQueue<T> stores every item in a `sizeof(T)` slot, so a mix of
+ * message types pays for the largest one each time. Here each record takes
+ * only its own bytes:
+ *   | length (4 bytes) | payload | pad to 4 bytes |
+ * laid out back to back in `buffer`. A record never wraps: when it does not
+ * fit before the end of the buffer, the producer writes a padding record
+ * (length `Padding`) over the rest and starts the record at offset 0; the
+ * consumer skips padding on its own, so callers only ever see whole,
+ * contiguous payloads.
+ *
+ * - `head` and `tail` are byte counters that only increase, on separate
+ *   cache lines with a cached copy of the other side's, as in LockFreeQueue.
+ * - `try_claim(n)` / `commit(m)` build a record in place (m <= n: claim the
+ *   most a message can take, commit what it took); `try_peek` / `release`
+ *   read one in place. `enqueue` / `dequeue` copy.
+ * - Padding and the record after it are published by the same store, so a
+ *   padding record is never visible on its own.
+ * - A payload is 1 to `MaxRecord` bytes (half the ring, less the length
+ *   prefix). The bound guarantees that a record fits once the consumer has
+ *   drained the ring, wherever the wrap point is; the lower one keeps an
+ *   empty span free to mean "no record".
+ * Payloads are 4-byte aligned; read multi-byte fields with memcpy or through
+ * packed structs.
+ */
+template <size_t Capacity>
+class ByteQueue {
+    static_assert(Capacity >= 64 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two");
+
+public:
+    static constexpr size_t MaxRecord = Capacity / 2 - sizeof(uint32_t);
+
+    ByteQueue() : tail(0), cachedHead(0), claimedTail(0), head(0), cachedTail(0), peekedHead(0) {}
+
+    ByteQueue(const ByteQueue&) = delete;
+    ByteQueue& operator=(const ByteQueue&) = delete;
+
+    /**
+     * Producer side: returns space for a payload of up to `length` bytes,
+     * or nullptr if the ring does not have that much room yet. Nothing is
+     * visible to the consumer until `commit`. Throws std::length_error if
+     * `length` is 0 or exceeds MaxRecord.
+     */
+    uint8_t* try_claim(size_t length) {
+        if (length == 0 || length > MaxRecord) {
+            throw std::length_error("ByteQueue record must be 1 to MaxRecord bytes");
+        }
+        uint64_t current_tail = tail.load(std::memory_order_relaxed);
+        size_t offset = current_tail & Mask;
+        size_t contiguous = Capacity - offset;
+        size_t needed = recordSize(length);
+        size_t total = needed <= contiguous ? needed : contiguous + needed;
+        if (Capacity - (current_tail - cachedHead) < total) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (Capacity - (current_tail - cachedHead) < total) {
+                return nullptr;
+            }
+        }
+        if (needed > contiguous) {
+            writeLength(offset, Padding);
+            current_tail += contiguous;
+            offset = 0;
+        }
+        claimedTail = current_tail;
+        return buffer + offset + sizeof(uint32_t);
+    }
+
+    /// Publishes the last claim as a record of `length` bytes (at least 1,
+    /// at most what was claimed), along with any padding before it.
+    void commit(size_t length) {
+        writeLength(claimedTail & Mask, static_cast<uint32_t>(length));
+        tail.store(claimedTail + recordSize(length), std::memory_order_release);
+    }
+
+    bool enqueue(std::span<const uint8_t> record) {
+        uint8_t* payload = try_claim(record.size());
+        if (payload == nullptr) {
+            return false; // Not enough room
+        }
+        std::memcpy(payload, record.data(), record.size());
+        commit(record.size());
+        return true;
+    }
+
+    /**
+     * Consumer side: returns the oldest record, to be used in place, or an
+     * empty span if the ring is empty. The record stays in the ring (and
+     * repeated calls return it) until `release`.
+     */
+    std::span<const uint8_t> try_peek() {
+        uint64_t current_head = head.load(std::memory_order_relaxed);
+        if (current_head == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (current_head == cachedTail) {
+                return {};
+            }
+        }
+        size_t offset = current_head & Mask;
+        uint32_t length = readLength(offset);
+        if (length == Padding) {
+            current_head += Capacity - offset;
+            offset = 0;
+            length = readLength(0);
+        }
+        peekedHead = current_head + recordSize(length);
+        return {buffer + offset + sizeof(uint32_t), length};
+    }
+
+    /// Frees the record returned by the last successful `try_peek`.
+    void release() { head.store(peekedHead, std::memory_order_release); }
+
+    /**
+     * Copies the oldest record into the front of `out` and returns its
+     * length, or 0 if the ring is empty. Throws std::length_error, leaving
+     * the record in the ring, if `out` is too small.
+     */
+    size_t dequeue(std::span<uint8_t> out) {
+        std::span<const uint8_t> record = try_peek();
+        if (record.empty()) {
+            return 0;
+        }
+        if (record.size() > out.size()) {
+            throw std::length_error("ByteQueue record larger than the output buffer");
+        }
+        std::memcpy(out.data(), record.data(), record.size());
+        release();
+        return record.size();
+    }
+
+    /// Bytes in use, prefixes and padding included; same caveats as
+    /// LockFreeQueue::size.
+    size_t size_bytes() const {
+        uint64_t current_head = head.load(std::memory_order_acquire);
+        uint64_t current_tail = tail.load(std::memory_order_acquire);
+        return current_tail > current_head ? current_tail - current_head : 0;
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+    /// Ring bytes taken by a record with a payload of `length` bytes.
+    static constexpr size_t recordSize(size_t length) {
+        return (sizeof(uint32_t) + length + RecordAlign - 1) & ~(RecordAlign - 1);
+    }
+
+private:
+    static constexpr uint64_t Mask = Capacity - 1;
+    static constexpr size_t RecordAlign = alignof(uint32_t);
+    static constexpr uint32_t Padding = UINT32_MAX;
+
+    void writeLength(size_t offset, uint32_t length) {
+        std::memcpy(buffer + offset, &length, sizeof(length));
+    }
+
+    uint32_t readLength(size_t offset) const {
+        uint32_t length;
+        std::memcpy(&length, buffer + offset, sizeof(length));
+        return length;
+    }
+
+    // Producer line.
+    alignas(CacheLineSize) std::atomic<uint64_t> tail;
+    uint64_t cachedHead;
+    uint64_t claimedTail;
+
+    // Consumer line.
+    alignas(CacheLineSize) std::atomic<uint64_t> head;
+    uint64_t cachedTail;
+    uint64_t peekedHead;
+
+    alignas(CacheLineSize) uint8_t buffer[Capacity];
+};
@@ -0,0 +1,198 @@
+// Build: g++ -std=c++20 -O2 -march=native -pthread core_matrix_benchmark.cpp -o core_matrix_benchmark
+// Usage: core_matrix_benchmark [--cpus LIST] [queue...]
+//   LIST is a cpu list such as 0-3,8,10 (default: every CPU this process may
+//   use); queue is any of spsc mpsc mpmc broadcast bytes (default: all).
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark_support.h"
+#include "broadcast_queue.h"
+#include "byte_queue.h"
+#include "mpmc_queue.h"
+#include "queue.h"
+
+/**
+ * Core-to-core cost of every queue, for every pair of CPUs.
+ *
+ * For each (producer cpu, consumer cpu) pair, with both threads pinned:
+ * - latency: a ping-pong over two queues, timed with the TSC around each
+ *   round trip; the cell is half the median round trip, in ns,
+ * - throughput: `Items` integers streamed one way, in M items/s.
+ * Rows are producer CPUs, columns consumer CPUs. The matrix shows the
+ * machine's topology directly: SMT siblings, cores sharing an L3, and cores
+ * on another socket form visibly different blocks. The diagonal runs both
+ * threads on one CPU, so it measures the scheduler, not the queue.
+ */
+
+constexpr size_t QueueSize = 1024;
+constexpr uint64_t Items = 2'000'000;
+constexpr int RoundTrips = 20'000;
+
+/// Every queue behind the same two calls.
+template <typename Queue>
+struct Plain {
+    Queue queue;
+    bool send(uint64_t value) { return queue.enqueue(value); }
+    bool receive(uint64_t& value) { return queue.dequeue(value); }
+};
+
+struct Broadcast {
+    using Ring = BroadcastQueue<uint64_t, QueueSize, 1>;
+    Ring ring;
+    Ring::Consumer consumer = *ring.subscribe();
+    bool send(uint64_t value) { return ring.publish(value); }
+    bool receive(uint64_t& value) { return consumer.poll(value); }
+};
+
+struct Bytes {
+    ByteQueue<QueueSize * 16> ring;
+    bool send(uint64_t value) {
+        return ring.enqueue({reinterpret_cast<const uint8_t*>(&value), sizeof(value)});
+    }
+    bool receive(uint64_t& value) {
+        std::span<const uint8_t> record = ring.try_peek();
+        if (record.empty()) {
+            return false;
+        }
+        std::memcpy(&value, record.data(), sizeof(value));
+        ring.release();
+        return true;
+    }
+};
+
+template <typename Channel>
+double oneWayNs(int producerCpu, int consumerCpu) {
+    auto ping = std::make_unique<Channel>();
+    auto pong = std::make_unique<Channel>();
+    std::vector<uint64_t> ticks(RoundTrips);
+
+    std::thread echo([&] {
+        pinToCpu(consumerCpu);
+        uint64_t value;
+        for (int i = 0; i < RoundTrips; ++i) {
+            spinUntil([&] { return ping->receive(value); });
+            spinUntil([&] { return pong->send(value); });
+        }
+    });
+    std::thread producer([&] {
+        pinToCpu(producerCpu);
+        uint64_t value;
+        for (int i = 0; i < RoundTrips; ++i) {
+            uint64_t start = readTsc();
+            spinUntil([&] { return ping->send(start); });
+            spinUntil([&] { return pong->receive(value); });
+            ticks[i] = readTsc() - start;
+        }
+    });
+    producer.join();
+    echo.join();
+
+    std::nth_element(ticks.begin(), ticks.begin() + RoundTrips / 2, ticks.end());
+    return ticks[RoundTrips / 2] * tscNsPerTick() / 2;
+}
+
+template <typename Channel>
+double itemsPerSecond(int producerCpu, int consumerCpu) {
+    auto channel = std::make_unique<Channel>();
+    uint64_t sum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread consumer([&] {
+        pinToCpu(consumerCpu);
+        uint64_t value;
+        for (uint64_t i = 0; i < Items; ++i) {
+            spinUntil([&] { return channel->receive(value); });
+            sum += value;
+        }
+    });
+    std::thread producer([&] {
+        pinToCpu(producerCpu);
+        for (uint64_t i = 0; i < Items; ++i) {
+            spinUntil([&] { return channel->send(i); });
+        }
+    });
+    producer.join();
+    consumer.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (sum != Items * (Items - 1) / 2) {
+        std::fprintf(stderr, "lost items on cpus %d -> %d\n", producerCpu, consumerCpu);
+        std::exit(1);
+    }
+    return Items / elapsed.count();
+}
+
+void printMatrix(const char* title, const std::vector<int>& cpus,
+                 const std::vector<double>& cells) {
+    std::printf("%s\n%6s", title, "p \\ c");
+    for (int cpu : cpus) {
+        std::printf(" %7d", cpu);
+    }
+    std::printf("\n");
+    for (size_t row = 0; row < cpus.size(); ++row) {
+        std::printf("%6d", cpus[row]);
+        for (size_t column = 0; column < cpus.size(); ++column) {
+            std::printf(" %7.1f", cells[row * cpus.size() + column]);
+        }
+        std::printf("\n");
+    }
+}
+
+template <typename Channel>
+void run(const char* name, const std::vector<int>& cpus) {
+    std::vector<double> latency;
+    std::vector<double> throughput;
+    for (int producerCpu : cpus) {
+        for (int consumerCpu : cpus) {
+            latency.push_back(oneWayNs<Channel>(producerCpu, consumerCpu));
+            throughput.push_back(itemsPerSecond<Channel>(producerCpu, consumerCpu) / 1e6);
+        }
+    }
+    std::printf("\n== %s ==\n", name);
+    printMatrix("one-way latency, ns (half the median round trip):", cpus, latency);
+    printMatrix("throughput, M items/s:", cpus, throughput);
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> cpus = allowedCpus();
+    std::vector<std::string> queues;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--cpus") == 0 && i + 1 < argc) {
+            cpus = parseCpuList(argv[++i]);
+        } else {
+            queues.push_back(argv[i]);
+        }
+    }
+    auto wanted = [&](const char* name) {
+        return queues.empty() || std::find(queues.begin(), queues.end(), name) != queues.end();
+    };
+
+    std::printf("%zu cpus, %d round trips and %llu items per cell, TSC %.3f ns/tick\n",
+                cpus.size(), RoundTrips, static_cast<unsigned long long>(Items),
+                tscNsPerTick());
+    if (wanted("spsc")) {
+        run<Plain<LockFreeQueue<uint64_t, QueueSize>>>("spsc: LockFreeQueue", cpus);
+    }
+    if (wanted("mpsc")) {
+        run<Plain<MpscQueue<uint64_t, QueueSize>>>("mpsc: MpscQueue", cpus);
+    }
+    if (wanted("mpmc")) {
+        run<Plain<MpmcQueue<uint64_t, QueueSize>>>("mpmc: MpmcQueue", cpus);
+    }
+    if (wanted("broadcast")) {
+        run<Broadcast>("broadcast: BroadcastQueue, one consumer", cpus);
+    }
+    if (wanted("bytes")) {
+        run<Bytes>("bytes: ByteQueue, 8-byte records", cpus);
+    }
+    return 0;
+}
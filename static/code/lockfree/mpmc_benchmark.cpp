@@ -0,0 +1,122 @@
+// Build: g++ -std=c++20 -O2 -march=native -pthread mpmc_benchmark.cpp -o mpmc_benchmark
+// Usage: mpmc_benchmark [maxProducers]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "benchmark_support.h"
+#include "mpmc_queue.h"
+
+/**
+ * Contention benchmark for the multi-producer queues.
+ *
+ * For 1..N producers, `Items` integers in total are pushed through:
+ * - MpscQueue with one consumer,
+ * - MpmcQueue with one consumer,
+ * - MpmcQueue with as many consumers as producers,
+ * - a bounded std::deque behind a std::mutex, with one consumer,
+ * and the table shows the total items per second for each, to pick the
+ * primitive per pipeline stage. Every run checks that the consumers'
+ * total equals what the producers sent.
+ */
+
+constexpr size_t QueueSize = 4096;
+constexpr uint64_t Items = 8'000'000;
+
+/// The lock-based reference, with the same interface.
+template <typename T, size_t Size>
+class MutexQueue {
+public:
+    bool enqueue(const T& item) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (items.size() == Size) {
+            return false;
+        }
+        items.push_back(item);
+        return true;
+    }
+
+    bool dequeue(T& item) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (items.empty()) {
+            return false;
+        }
+        item = items.front();
+        items.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex mutex;
+    std::deque<T> items;
+};
+
+template <typename Queue>
+double itemsPerSecond(size_t producers, size_t consumers) {
+    auto queue = std::make_unique<Queue>();
+    std::atomic<int64_t> remaining{static_cast<int64_t>(Items)};
+    std::atomic<uint64_t> received{0};
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t c = 0; c < consumers; ++c) {
+        threads.emplace_back([&] {
+            uint64_t sum = 0;
+            uint64_t value;
+            // Consumers share the work: each claims one item of `remaining`
+            // before waiting for it, so none waits for an item that another
+            // consumer will take.
+            while (remaining.fetch_sub(1, std::memory_order_relaxed) > 0) {
+                spinUntil([&] { return queue->dequeue(value); });
+                sum += value;
+            }
+            received.fetch_add(sum);
+        });
+    }
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            // Producer p sends p, p + producers, p + 2 * producers, ...
+            for (uint64_t value = p; value < Items; value += producers) {
+                spinUntil([&] { return queue->enqueue(value); });
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (received.load() != Items * (Items - 1) / 2) {
+        std::fprintf(stderr, "lost items with %zu producers, %zu consumers\n", producers,
+                     consumers);
+        std::exit(1);
+    }
+    return Items / elapsed.count();
+}
+
+int main(int argc, char** argv) {
+    size_t maxProducers = argc > 1 ? std::strtoul(argv[1], nullptr, 10)
+                                   : std::max(4u, std::thread::hardware_concurrency());
+    std::printf("%u hardware threads, %llu items per run, M items/s:\n",
+                std::thread::hardware_concurrency(), static_cast<unsigned long long>(Items));
+    std::printf("%-10s %10s %10s %14s %12s\n", "producers", "MPSC", "MPMC", "MPMC (PxP)",
+                "mutex");
+    for (size_t producers = 1; producers <= maxProducers; ++producers) {
+        double mpsc = itemsPerSecond<MpscQueue<uint64_t, QueueSize>>(producers, 1);
+        double mpmc = itemsPerSecond<MpmcQueue<uint64_t, QueueSize>>(producers, 1);
+        double mpmcShared = itemsPerSecond<MpmcQueue<uint64_t, QueueSize>>(producers, producers);
+        double locked = itemsPerSecond<MutexQueue<uint64_t, QueueSize>>(producers, 1);
+        std::printf("%-10zu %10.1f %10.1f %14.1f %12.1f\n", producers, mpsc / 1e6, mpmc / 1e6,
+                    mpmcShared / 1e6, locked / 1e6);
+    }
+    return 0;
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "queue.h"
+
+/**
+ * Bounded multi-producer queues with per-slot sequence numbers (Vyukov).
+ *
+ * Every slot carries a `sequence` that says whose turn it is:
+ * - `sequence == pos`: free for the producer that claims position `pos`,
+ * - `sequence == pos + 1`: holds the item written at `pos`, ready for the
+ *   consumer of `pos`,
+ * - the consumer then sets it to `pos + Size`, freeing it for the producer
+ *   one lap later.
+ * A producer claims a position with one CAS on `enqueuePos`, then writes
+ * its slot and publishes it with a release store to that slot's `sequence`.
+ * Producers contend only on `enqueuePos`, never on each other's slots. A
+ * producer that stalls between claim and publish delays the consumer of
+ * that one position only, which is the price of having no locks.
+ *
+ * `MpscQueue` has a single consumer, which owns `dequeuePos` and needs no
+ * CAS. `MpmcQueue` also lets consumers claim positions with a CAS. Both have
+ * the `enqueue` / `dequeue` interface of LockFreeQueue, and `Size` must be a
+ * power of two.
+ */
+template <typename T, size_t Size, bool MultiConsumer>
+class SequencedQueue {
+    static_assert(Size >= 2 && (Size & (Size - 1)) == 0, "Size must be a power of two");
+    // `dequeue` moves the item out after claiming its position; a throw there
+    // would leave the slot unreleased and wedge producers one lap later.
+    static_assert(std::is_nothrow_move_assignable_v<T> && std::is_nothrow_destructible_v<T>,
+                  "T must be nothrow move assignable and destructible");
+
+public:
+    SequencedQueue() {
+        for (size_t i = 0; i < Size; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    SequencedQueue(const SequencedQueue&) = delete;
+    SequencedQueue& operator=(const SequencedQueue&) = delete;
+
+    ~SequencedQueue() requires std::is_trivially_destructible_v<T> = default;
+
+    ~SequencedQueue() {
+        uint64_t end = enqueuePos.load(std::memory_order_acquire);
+        for (uint64_t pos = dequeuePos.load(std::memory_order_relaxed); pos != end; ++pos) {
+            std::destroy_at(slots[pos & Mask].item());
+        }
+    }
+
+    bool enqueue(const T& item) { return emplace(item); }
+
+    bool enqueue(T&& item) { return emplace(std::move(item)); }
+
+    /**
+     * Any thread. Constructs an item from `args` in the claimed slot. A
+     * claimed position must be published, so a constructor that may throw
+     * runs first, into a temporary that is then moved into the slot; a T
+     * that can throw on both paths is rejected at compile time, as a throw
+     * after the claim would leave the slot unpublished and wedge the queue.
+     */
+    template <typename... Args>
+    bool emplace(Args&&... args) {
+        static_assert(std::is_nothrow_constructible_v<T, Args&&...> ||
+                          std::is_nothrow_move_constructible_v<T>,
+                      "T must be nothrow constructible from the arguments, or nothrow movable");
+        if constexpr (!std::is_nothrow_constructible_v<T, Args&&...>) {
+            return emplace(T(std::forward<Args>(args)...));
+        } else {
+            return emplaceClaimed(std::forward<Args>(args)...);
+        }
+    }
+
+    /// Any thread for MpmcQueue, one thread for MpscQueue.
+    bool dequeue(T& item) {
+        uint64_t pos = dequeuePos.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &slots[pos & Mask];
+            uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+            int64_t lag = static_cast<int64_t>(sequence - (pos + 1));
+            if (lag < 0) {
+                return false; // Queue is empty, or the producer of `pos` has not published yet
+            }
+            if constexpr (MultiConsumer) {
+                if (lag == 0) {
+                    if (dequeuePos.compare_exchange_weak(pos, pos + 1,
+                                                         std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else {
+                    pos = dequeuePos.load(std::memory_order_relaxed);
+                }
+            } else {
+                dequeuePos.store(pos + 1, std::memory_order_relaxed);
+                break;
+            }
+        }
+        item = std::move(*slot->item());
+        std::destroy_at(slot->item());
+        slot->sequence.store(pos + Size, std::memory_order_release);
+        return true;
+    }
+
+    /// Snapshot of the number of items claimed but not yet consumed.
+    size_t size() const {
+        uint64_t dequeued = dequeuePos.load(std::memory_order_relaxed);
+        uint64_t enqueued = enqueuePos.load(std::memory_order_relaxed);
+        return enqueued > dequeued ? std::min<uint64_t>(enqueued - dequeued, Size) : 0;
+    }
+
+    static constexpr size_t capacity() { return Size; }
+
+private:
+    static constexpr uint64_t Mask = Size - 1;
+
+    /// Claims a position and constructs in place; `args` must not throw.
+    template <typename... Args>
+    bool emplaceClaimed(Args&&... args) noexcept {
+        uint64_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &slots[pos & Mask];
+            uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+            int64_t lag = static_cast<int64_t>(sequence - pos);
+            if (lag == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (lag < 0) {
+                return false; // Queue is full: the slot still holds last lap's item
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        std::construct_at(slot->item(), std::forward<Args>(args)...);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    struct Slot {
+        std::atomic<uint64_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* item() { return std::launder(reinterpret_cast<T*>(storage)); }
+    };
+
+    alignas(CacheLineSize) std::atomic<uint64_t> enqueuePos{0};
+    alignas(CacheLineSize) std::atomic<uint64_t> dequeuePos{0};
+    alignas(CacheLineSize) std::array<Slot, Size> slots;
+};
+
+template <typename T, size_t Size>
+using MpscQueue = SequencedQueue<T, Size, false>;
+
+template <typename T, size_t Size>
+using MpmcQueue = SequencedQueue<T, Size, true>;
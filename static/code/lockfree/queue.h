@@ -0,0 +1,250 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Cache line size used to keep producer and consumer state apart.
+ * std::hardware_destructive_interference_size is also 64 on x86-64, but
+ * GCC warns when it is used in a header, because it changes with -mtune.
+ */
+inline constexpr size_t CacheLineSize = 64;
+
+/**
+ * Single-producer / single-consumer bounded ring.
+ * - Producer calls (`enqueue*`, `emplace`, `try_claim`, `commit`) come from one
+ *   thread and consumer calls (`dequeue*`, `try_pop`, `try_peek`, `release`)
+ *   from another.
+ * - `Size` must be a power of two. `head` and `tail` are 64-bit counters
+ *   that only ever increase (they would take centuries to wrap); a slot is
+ *   `counter & Mask`, so there is no division, and `tail - head` is the
+ *   exact fill level, so all `Size` slots are usable.
+ * - `tail` (written by the producer) and `head` (written by the consumer)
+ *   sit on separate cache lines, away from `buffer`, so neither side
+ *   invalidates the other's line on its own writes.
+ * - Each side keeps a plain copy of the other side's counter and reloads
+ *   the shared atomic only when the copy says the queue is full (producer)
+ *   or empty (consumer). In steady state an operation touches only its own
+ *   line and the slot, instead of pulling the other core's line every time.
+ * - Slots are raw storage: an item is constructed in place by `emplace`
+ *   (or `enqueue`), moved out by `try_pop` (or `dequeue`) and destroyed, so
+ *   T can be move-only (a task, an owning buffer) and need not be default
+ *   constructible. Items still queued when the queue is destroyed are
+ *   destroyed with it.
+ * - `try_claim` / `commit` and `try_peek` / `release` let the producer build
+ *   an item directly in its slot and the consumer use it there, saving the
+ *   copy in and the copy out of `enqueue` / `dequeue`. `try_claim` hands out
+ *   a slot with no object in it, so it needs a trivially copyable T; other
+ *   types use `emplace`. `release` destroys the item it frees.
+ * - `enqueue_bulk` / `dequeue_bulk` move a run of items with at most two
+ *   contiguous copies (before and after the wrap) and publish them with a
+ *   single store, so a burst costs one cache line handoff, not one per item.
+ */
+template <typename T, size_t Size>
+class LockFreeQueue {
+    static_assert(Size >= 2 && (Size & (Size - 1)) == 0, "Size must be a power of two");
+
+public:
+    LockFreeQueue() : tail(0), cachedHead(0), head(0), cachedTail(0) {}
+
+    LockFreeQueue(const LockFreeQueue&) = delete;
+    LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+    ~LockFreeQueue() requires std::is_trivially_destructible_v<T> = default;
+
+    ~LockFreeQueue() {
+        uint64_t current_tail = tail.load(std::memory_order_acquire);
+        for (uint64_t i = head.load(std::memory_order_relaxed); i != current_tail; ++i) {
+            std::destroy_at(slot(i));
+        }
+    }
+
+    /// Constructs an item in the next slot from `args`; false if the queue
+    /// is full. If the constructor throws, nothing is enqueued.
+    template <typename... Args>
+    bool emplace(Args&&... args) {
+        uint64_t current_tail = tail.load(std::memory_order_relaxed);
+        if (!hasRoom(current_tail)) {
+            return false; // Queue is full
+        }
+        std::construct_at(slot(current_tail), std::forward<Args>(args)...);
+        tail.store(current_tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool enqueue(const T& item) { return emplace(item); }
+
+    bool enqueue(T&& item) { return emplace(std::move(item)); }
+
+    /// Moves the oldest item into `item` and destroys it in the queue; false
+    /// if the queue is empty.
+    bool try_pop(T& item) {
+        T* oldest = try_peek();
+        if (oldest == nullptr) {
+            return false; // Queue is empty
+        }
+        item = std::move(*oldest);
+        release();
+        return true;
+    }
+
+    bool dequeue(T& item) { return try_pop(item); }
+
+    /**
+     * Producer side, zero-copy: returns the next free slot to be filled in
+     * place, or nullptr if the queue is full. The slot holds whatever was
+     * last written there. Nothing is visible to the consumer until `commit`.
+     */
+    T* try_claim()
+        requires std::is_trivially_copyable_v<T>
+    {
+        uint64_t current_tail = tail.load(std::memory_order_relaxed);
+        return hasRoom(current_tail) ? slot(current_tail) : nullptr;
+    }
+
+    /// Publishes the slot returned by the last successful `try_claim`.
+    void commit()
+        requires std::is_trivially_copyable_v<T>
+    {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+     * Consumer side, zero-copy: returns the oldest item, to be processed in
+     * place, or nullptr if the queue is empty. The item stays in the queue
+     * (and repeated calls return it) until `release`.
+     */
+    T* try_peek() {
+        uint64_t current_head = head.load(std::memory_order_relaxed);
+        if (current_head == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (current_head == cachedTail) {
+                return nullptr;
+            }
+        }
+        return slot(current_head);
+    }
+
+    /// Destroys the item returned by the last successful `try_peek` and
+    /// frees its slot.
+    void release() {
+        uint64_t current_head = head.load(std::memory_order_relaxed);
+        std::destroy_at(slot(current_head));
+        head.store(current_head + 1, std::memory_order_release);
+    }
+
+    /**
+     * Enqueues as many of `items` as fit, in order; returns how many. If a
+     * copy throws, the items already copied are destroyed and nothing is
+     * enqueued.
+     */
+    size_t enqueue_bulk(std::span<const T> items) {
+        uint64_t current_tail = tail.load(std::memory_order_relaxed);
+
+        size_t free = Size - (current_tail - cachedHead);
+        if (free < items.size()) {
+            cachedHead = head.load(std::memory_order_acquire);
+            free = Size - (current_tail - cachedHead);
+        }
+        size_t count = std::min(free, items.size());
+        if (count == 0) {
+            return 0;
+        }
+
+        size_t index = current_tail & Mask;
+        size_t first = std::min(count, Size - index);
+        // Each call destroys its own partial run if a copy throws; the run
+        // before the wrap is then left to us.
+        std::uninitialized_copy_n(items.data(), first, slot(index));
+        try {
+            std::uninitialized_copy_n(items.data() + first, count - first, slot(0));
+        } catch (...) {
+            std::destroy_n(slot(index), first);
+            throw;
+        }
+        tail.store(current_tail + count, std::memory_order_release);
+        return count;
+    }
+
+    /**
+     * Dequeues up to `items.size()` items into the front of `items` (by
+     * move); returns how many.
+     */
+    size_t dequeue_bulk(std::span<T> items) {
+        uint64_t current_head = head.load(std::memory_order_relaxed);
+
+        size_t available = cachedTail - current_head;
+        if (available < items.size()) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            available = cachedTail - current_head;
+        }
+        size_t count = std::min(available, items.size());
+        if (count == 0) {
+            return 0;
+        }
+
+        size_t index = current_head & Mask;
+        size_t first = std::min(count, Size - index);
+        std::move(slot(index), slot(index) + first, items.data());
+        std::move(slot(0), slot(0) + (count - first), items.data() + first);
+        std::destroy_n(slot(index), first);
+        std::destroy_n(slot(0), count - first);
+        head.store(current_head + count, std::memory_order_release);
+        return count;
+    }
+
+    /**
+     * Items in the queue, in [0, Size]. Exact when the other side is idle;
+     * otherwise it is an upper bound when called by the producer (the
+     * consumer may be draining) and a lower bound when called by the
+     * consumer.
+     */
+    size_t size() const {
+        uint64_t current_head = head.load(std::memory_order_acquire);
+        uint64_t current_tail = tail.load(std::memory_order_acquire);
+        return std::min<uint64_t>(current_tail - current_head, Size);
+    }
+
+    static constexpr size_t capacity() { return Size; }
+
+private:
+    static constexpr uint64_t Mask = Size - 1;
+
+    /// Storage for one T, with no object in it until one is constructed.
+    struct alignas(T) Slot {
+        unsigned char bytes[sizeof(T)];
+    };
+
+    T* slot(uint64_t counter) {
+        return std::launder(reinterpret_cast<T*>(buffer[counter & Mask].bytes));
+    }
+
+    /// Producer: whether the slot at `current_tail` is free.
+    bool hasRoom(uint64_t current_tail) {
+        if (current_tail - cachedHead == Size) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (current_tail - cachedHead == Size) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Producer line.
+    alignas(CacheLineSize) std::atomic<uint64_t> tail;
+    uint64_t cachedHead;
+
+    // Consumer line.
+    alignas(CacheLineSize) std::atomic<uint64_t> head;
+    uint64_t cachedTail;
+
+    alignas(CacheLineSize) std::array<Slot, Size> buffer;
+};
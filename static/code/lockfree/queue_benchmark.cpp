@@ -0,0 +1,296 @@
+// Build: g++ -std=c++20 -O2 -march=native -pthread queue_benchmark.cpp -o queue_benchmark
+// Usage: queue_benchmark [producerCpu consumerCpu]
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "benchmark_support.h"
+#include "queue.h"
+
+/**
+ * Two-thread benchmark of the SPSC queue.
+ * - throughput: the producer streams `Items` integers, the consumer drains
+ *   them; reports items per second.
+ * - bulk throughput: the same stream moved with enqueue_bulk/dequeue_bulk
+ *   in bursts of `batch` items.
+ * - 64-byte events: a book-event-sized item moved by copy (enqueue/dequeue)
+ *   and in place (try_claim/commit, try_peek/release).
+ * - ping-pong: two queues, one per direction; each side echoes what it
+ *   receives, so every hop pays for the cache line handoff; reports the
+ *   round-trip time.
+ * Earlier versions of the queue are kept here as references:
+ * - `baseline::LockFreeQueue`: the original layout (head, tail and buffer
+ *   packed together, every operation loads the other side's index),
+ * - `baseline::ModuloQueue`: padded lines and cached indices, but wrapped
+ *   indices advanced with `% Size`, which is a division unless `Size` is a
+ *   power of two, and one slot kept empty.
+ */
+
+namespace baseline {
+
+template <typename T, size_t Size>
+class LockFreeQueue {
+public:
+    LockFreeQueue() : head(0), tail(0) {}
+
+    bool enqueue(const T& item) {
+        size_t current_tail = tail.load(std::memory_order_relaxed);
+        size_t next_tail = (current_tail + 1) % Size;
+        if (next_tail == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        buffer[current_tail] = item;
+        tail.store(next_tail, std::memory_order_release);
+        return true;
+    }
+
+    bool dequeue(T& item) {
+        size_t current_head = head.load(std::memory_order_relaxed);
+        if (current_head == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = buffer[current_head];
+        head.store((current_head + 1) % Size, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, Size> buffer;
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+};
+
+template <typename T, size_t Size>
+class ModuloQueue {
+public:
+    bool enqueue(const T& item) {
+        size_t current_tail = tail.load(std::memory_order_relaxed);
+        size_t next_tail = (current_tail + 1) % Size;
+        if (next_tail == cachedHead) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (next_tail == cachedHead) {
+                return false;
+            }
+        }
+        buffer[current_tail] = item;
+        tail.store(next_tail, std::memory_order_release);
+        return true;
+    }
+
+    bool dequeue(T& item) {
+        size_t current_head = head.load(std::memory_order_relaxed);
+        if (current_head == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (current_head == cachedTail) {
+                return false;
+            }
+        }
+        item = buffer[current_head];
+        head.store((current_head + 1) % Size, std::memory_order_release);
+        return true;
+    }
+
+private:
+    alignas(CacheLineSize) std::atomic<size_t> tail{0};
+    size_t cachedHead = 0;
+    alignas(CacheLineSize) std::atomic<size_t> head{0};
+    size_t cachedTail = 0;
+    alignas(CacheLineSize) std::array<T, Size> buffer;
+};
+
+} // namespace baseline
+
+constexpr size_t QueueSize = 1024;
+constexpr uint64_t Items = 20'000'000;
+constexpr uint64_t RoundTrips = 1'000'000;
+
+int producerCpu = -1;
+int consumerCpu = -1;
+
+template <typename Queue>
+double throughput() {
+    auto queue = std::make_unique<Queue>();
+    uint64_t sum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread consumer([&] {
+        pinToCpu(consumerCpu);
+        uint64_t value;
+        for (uint64_t i = 0; i < Items; ++i) {
+            spinUntil([&] { return queue->dequeue(value); });
+            sum += value;
+        }
+    });
+    pinToCpu(producerCpu);
+    for (uint64_t i = 0; i < Items; ++i) {
+        spinUntil([&] { return queue->enqueue(i); });
+    }
+    consumer.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (sum != Items * (Items - 1) / 2) {
+        std::fprintf(stderr, "lost items\n");
+        std::exit(1);
+    }
+    return Items / elapsed.count();
+}
+
+template <typename Queue>
+double bulkThroughput(size_t batch) {
+    auto queue = std::make_unique<Queue>();
+    uint64_t sum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread consumer([&] {
+        pinToCpu(consumerCpu);
+        std::vector<uint64_t> values(batch);
+        for (uint64_t received = 0; received < Items;) {
+            size_t count = 0;
+            spinUntil([&] { return (count = queue->dequeue_bulk(values)) != 0; });
+            for (size_t i = 0; i < count; ++i) {
+                sum += values[i];
+            }
+            received += count;
+        }
+    });
+    pinToCpu(producerCpu);
+    std::vector<uint64_t> values(batch);
+    for (uint64_t sent = 0; sent < Items;) {
+        size_t burst = std::min<uint64_t>(batch, Items - sent);
+        for (size_t i = 0; i < burst; ++i) {
+            values[i] = sent + i;
+        }
+        for (size_t done = 0; done < burst;) {
+            spinUntil([&] {
+                size_t count = queue->enqueue_bulk(std::span(values).subspan(done, burst - done));
+                done += count;
+                return count != 0;
+            });
+        }
+        sent += burst;
+    }
+    consumer.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (sum != Items * (Items - 1) / 2) {
+        std::fprintf(stderr, "lost items\n");
+        std::exit(1);
+    }
+    return Items / elapsed.count();
+}
+
+struct BookEvent {
+    uint64_t fields[8];
+};
+static_assert(sizeof(BookEvent) == 64);
+
+template <bool InPlace>
+double eventThroughput() {
+    using Queue = LockFreeQueue<BookEvent, QueueSize>;
+    auto queue = std::make_unique<Queue>();
+    uint64_t sum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread consumer([&] {
+        pinToCpu(consumerCpu);
+        for (uint64_t i = 0; i < Items; ++i) {
+            if constexpr (InPlace) {
+                BookEvent* event;
+                spinUntil([&] { return (event = queue->try_peek()) != nullptr; });
+                sum += event->fields[0] + event->fields[7];
+                queue->release();
+            } else {
+                BookEvent event;
+                spinUntil([&] { return queue->dequeue(event); });
+                sum += event.fields[0] + event.fields[7];
+            }
+        }
+    });
+    pinToCpu(producerCpu);
+    for (uint64_t i = 0; i < Items; ++i) {
+        if constexpr (InPlace) {
+            BookEvent* event;
+            spinUntil([&] { return (event = queue->try_claim()) != nullptr; });
+            for (uint64_t& field : event->fields) {
+                field = i;
+            }
+            queue->commit();
+        } else {
+            BookEvent event;
+            for (uint64_t& field : event.fields) {
+                field = i;
+            }
+            spinUntil([&] { return queue->enqueue(event); });
+        }
+    }
+    consumer.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (sum != Items * (Items - 1)) {
+        std::fprintf(stderr, "lost events\n");
+        std::exit(1);
+    }
+    return Items / elapsed.count();
+}
+
+template <typename Queue>
+double roundTripNs() {
+    auto ping = std::make_unique<Queue>();
+    auto pong = std::make_unique<Queue>();
+
+    std::thread echo([&] {
+        pinToCpu(consumerCpu);
+        uint64_t value;
+        for (uint64_t i = 0; i < RoundTrips; ++i) {
+            spinUntil([&] { return ping->dequeue(value); });
+            spinUntil([&] { return pong->enqueue(value); });
+        }
+    });
+    pinToCpu(producerCpu);
+    auto start = std::chrono::steady_clock::now();
+    uint64_t value;
+    for (uint64_t i = 0; i < RoundTrips; ++i) {
+        spinUntil([&] { return ping->enqueue(i); });
+        spinUntil([&] { return pong->dequeue(value); });
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    echo.join();
+    return elapsed.count() / RoundTrips;
+}
+
+template <typename Queue>
+void run(const char* name) {
+    double itemsPerSecond = throughput<Queue>();
+    double roundTrip = roundTripNs<Queue>();
+    std::printf("%-28s %8.1f M items/s   ping-pong round trip %8.1f ns\n", name,
+                itemsPerSecond / 1e6, roundTrip);
+}
+
+int main(int argc, char** argv) {
+    if (argc == 3) {
+        producerCpu = std::atoi(argv[1]);
+        consumerCpu = std::atoi(argv[2]);
+    }
+    std::printf("producer cpu %d, consumer cpu %d, %u hardware threads\n", producerCpu,
+                consumerCpu, std::thread::hardware_concurrency());
+
+    run<baseline::LockFreeQueue<uint64_t, QueueSize>>("packed, % 1024");
+    run<baseline::ModuloQueue<uint64_t, QueueSize - 24>>("padded + cached, % 1000");
+    run<baseline::ModuloQueue<uint64_t, QueueSize>>("padded + cached, % 1024");
+    run<LockFreeQueue<uint64_t, QueueSize>>("padded + cached, & mask");
+    for (size_t batch : {16, 64, 256}) {
+        double itemsPerSecond = bulkThroughput<LockFreeQueue<uint64_t, QueueSize>>(batch);
+        std::printf("bulk, batch %-16zu %8.1f M items/s\n", batch, itemsPerSecond / 1e6);
+    }
+    std::printf("64 B events, copy            %8.1f M items/s\n", eventThroughput<false>() / 1e6);
+    std::printf("64 B events, in place        %8.1f M items/s\n", eventThroughput<true>() / 1e6);
+    return 0;
+}
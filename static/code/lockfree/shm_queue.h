@@ -0,0 +1,296 @@
+#pragma once
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "queue.h"
+
+/**
+ * LockFreeQueue in a shared-memory segment, for an SPSC hop between two
+ * processes on the same host.
+ *
+ * The segment is a versioned header followed by the queue itself:
+ *   | SharedQueueHeader | padding | LockFreeQueue<T, Size> |
+ * The creating process placement-constructs both (atomics included) and
+ * then sets `ready`; an attaching process waits for `ready` and checks the
+ * layout fields before touching the queue, so two builds that disagree on
+ * T or Size fail loudly instead of corrupting each other. After that, an
+ * operation costs what it costs between two threads: the queue's atomics
+ * are plain lock-free 64-bit words and work the same from any mapping.
+ *
+ * Backing: a file on a hugetlbfs mount (/dev/hugepages) when there is one,
+ * so the ring sits in 2 MiB pages and does not miss the TLB. Otherwise a
+ * POSIX shm_open object, with MADV_HUGEPAGE as a hint for kernels that back
+ * shmem with transparent huge pages.
+ *
+ * Peer liveness: each side records its pid in the header when it attaches
+ * and marks itself closed when it detaches cleanly. `peer()` tells a peer
+ * that has not attached yet, is running, has exited cleanly, or has died
+ * without detaching (crash, kill -9), so a consumer that sees an empty queue
+ * can tell a quiet producer from a dead one. Pid reuse can make a dead peer
+ * look alive for as long as an unrelated process holds its pid.
+ *
+ * T must be trivially copyable and free of pointers into either process.
+ */
+
+struct SharedQueueHeader {
+    static constexpr uint32_t Magic = 0x3151464c; // "LFQ1"
+    static constexpr uint32_t Version = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    uint64_t itemSize;
+    uint64_t itemAlign;
+    uint64_t capacity;
+    uint64_t queueOffset;
+    uint64_t segmentSize;
+    std::atomic<uint32_t> ready{0};
+    std::atomic<int32_t> pids[2] = {0, 0};     // indexed by SharedQueueRole
+    std::atomic<uint32_t> closed[2] = {0, 0};  // 1 after a clean detach
+};
+
+enum class SharedQueueRole : uint32_t { Producer = 0, Consumer = 1 };
+
+enum class PeerState {
+    Absent, // never attached
+    Alive,
+    Exited, // detached cleanly
+    Dead,   // attached, then disappeared without detaching
+};
+
+template <typename T, size_t Size>
+class SharedQueue {
+    static_assert(std::is_trivially_copyable_v<T>, "T is copied between processes");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free,
+                  "the queue's atomics must be address-free to be shared");
+
+public:
+    using Queue = LockFreeQueue<T, Size>;
+    using Role = SharedQueueRole;
+
+    /// Creates (or replaces) the segment `name` and attaches to it as `role`.
+    static SharedQueue create(const std::string& name, Role role) {
+        SharedQueue shared(name, role, true);
+        size_t queueOffset = alignUp(sizeof(SharedQueueHeader), alignof(Queue));
+        size_t size = queueOffset + sizeof(Queue);
+
+        shared.hugePages_ = shared.mapHugeTlb(alignUp(size, HugePageSize));
+        if (!shared.hugePages_) {
+            size = alignUp(size, static_cast<size_t>(sysconf(_SC_PAGESIZE)));
+            shm_unlink(name.c_str());
+            shared.fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            if (shared.fd < 0) {
+                throw std::runtime_error("shm_open " + name + ": " + std::strerror(errno));
+            }
+            if (ftruncate(shared.fd, static_cast<off_t>(size)) != 0) {
+                throw std::runtime_error("ftruncate " + name + ": " + std::strerror(errno));
+            }
+            shared.map(size);
+            madvise(shared.base, size, MADV_HUGEPAGE); // a hint; fine if unsupported
+        }
+
+        auto* header = new (shared.base) SharedQueueHeader;
+        header->magic = SharedQueueHeader::Magic;
+        header->version = SharedQueueHeader::Version;
+        header->itemSize = sizeof(T);
+        header->itemAlign = alignof(T);
+        header->capacity = Size;
+        header->queueOffset = queueOffset;
+        header->segmentSize = shared.size;
+        new (static_cast<char*>(shared.base) + queueOffset) Queue;
+        shared.registerSelf();
+        header->ready.store(1, std::memory_order_release);
+        return shared;
+    }
+
+    /**
+     * Attaches to the segment `name` as `role`, waiting up to `timeout` for
+     * its creator to publish it. Throws if it does not appear or its layout
+     * does not match this build's T and Size.
+     */
+    static SharedQueue attach(const std::string& name, Role role,
+                              std::chrono::milliseconds timeout = std::chrono::seconds(5)) {
+        SharedQueue shared(name, role, false);
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        for (;;) {
+            shared.fd = openHugeTlb(name, O_RDWR);
+            shared.hugePages_ = shared.fd >= 0;
+            if (!shared.hugePages_) {
+                shared.fd = shm_open(name.c_str(), O_RDWR, 0600);
+            }
+            struct stat info {};
+            if (shared.fd >= 0 && fstat(shared.fd, &info) == 0 &&
+                static_cast<size_t>(info.st_size) >= sizeof(SharedQueueHeader)) {
+                shared.map(static_cast<size_t>(info.st_size));
+                if (shared.header()->ready.load(std::memory_order_acquire) == 1) {
+                    break;
+                }
+                munmap(shared.base, shared.size);
+                shared.base = nullptr;
+            }
+            if (shared.fd >= 0) {
+                close(shared.fd);
+                shared.fd = -1;
+            }
+            if (std::chrono::steady_clock::now() >= deadline) {
+                throw std::runtime_error("shared queue " + name + " did not appear");
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        const SharedQueueHeader* header = shared.header();
+        if (header->magic != SharedQueueHeader::Magic ||
+            header->version != SharedQueueHeader::Version) {
+            throw std::runtime_error("shared queue " + name + ": unknown header version");
+        }
+        if (header->itemSize != sizeof(T) || header->itemAlign != alignof(T) ||
+            header->capacity != Size || header->segmentSize != shared.size ||
+            header->queueOffset != alignUp(sizeof(SharedQueueHeader), alignof(Queue))) {
+            throw std::runtime_error("shared queue " + name + ": layout does not match");
+        }
+        shared.registerSelf();
+        return shared;
+    }
+
+    SharedQueue(SharedQueue&& other) noexcept
+        : name(std::move(other.name)), role(other.role), owner(other.owner),
+          fd(std::exchange(other.fd, -1)), base(std::exchange(other.base, nullptr)),
+          size(other.size), hugePages_(other.hugePages_), registered(other.registered) {}
+
+    SharedQueue& operator=(SharedQueue&&) = delete;
+    SharedQueue(const SharedQueue&) = delete;
+    SharedQueue& operator=(const SharedQueue&) = delete;
+
+    ~SharedQueue() {
+        if (base != nullptr) {
+            if (registered) {
+                header()->closed[index(role)].store(1, std::memory_order_release);
+            }
+            munmap(base, size);
+        }
+        if (fd < 0) {
+            return; // moved from
+        }
+        close(fd);
+        // The name goes away with its creator; processes still attached keep
+        // their mapping until they detach.
+        if (owner) {
+            if (hugePages_) {
+                unlink(hugeTlbPath(name).c_str());
+            } else {
+                shm_unlink(name.c_str());
+            }
+        }
+    }
+
+    Queue& queue() {
+        return *reinterpret_cast<Queue*>(static_cast<char*>(base) + header()->queueOffset);
+    }
+
+    /// State of the process on the other end.
+    PeerState peer() const {
+        const SharedQueueHeader* shared = header();
+        size_t other = 1 - index(role);
+        pid_t pid = shared->pids[other].load(std::memory_order_acquire);
+        if (pid == 0) {
+            return PeerState::Absent;
+        }
+        if (shared->closed[other].load(std::memory_order_acquire) == 1) {
+            return PeerState::Exited;
+        }
+        if (kill(pid, 0) == 0 || errno == EPERM) {
+            return PeerState::Alive;
+        }
+        return PeerState::Dead;
+    }
+
+    bool hugePages() const { return hugePages_; }
+
+private:
+    static constexpr size_t HugePageSize = 2 * 1024 * 1024;
+
+    SharedQueue(std::string name, Role role, bool owner)
+        : name(std::move(name)), role(role), owner(owner) {}
+
+    static constexpr size_t alignUp(size_t value, size_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    static size_t index(Role role) { return static_cast<size_t>(role); }
+
+    static std::string hugeTlbPath(const std::string& name) {
+        return "/dev/hugepages" + (name.front() == '/' ? name : "/" + name);
+    }
+
+    /// A file on a hugetlbfs mount, or -1 if there is none.
+    static int openHugeTlb(const std::string& name, int flags) {
+        if (access("/dev/hugepages", W_OK) != 0) {
+            return -1;
+        }
+        return open(hugeTlbPath(name).c_str(), flags, 0600);
+    }
+
+    /// Creates and maps the segment on hugetlbfs; false if there is no
+    /// mount or no free huge pages.
+    bool mapHugeTlb(size_t length) {
+        fd = openHugeTlb(name, O_CREAT | O_TRUNC | O_RDWR);
+        if (fd < 0) {
+            return false;
+        }
+        void* address = MAP_FAILED;
+        if (ftruncate(fd, static_cast<off_t>(length)) == 0) {
+            address = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        if (address == MAP_FAILED) {
+            close(fd);
+            fd = -1;
+            unlink(hugeTlbPath(name).c_str());
+            return false;
+        }
+        base = address;
+        size = length;
+        return true;
+    }
+
+    void map(size_t length) {
+        void* address = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED) {
+            throw std::runtime_error("mmap " + name + ": " + std::strerror(errno));
+        }
+        base = address;
+        size = length;
+    }
+
+    void registerSelf() {
+        header()->closed[index(role)].store(0, std::memory_order_relaxed);
+        header()->pids[index(role)].store(getpid(), std::memory_order_release);
+        registered = true;
+    }
+
+    SharedQueueHeader* header() const { return static_cast<SharedQueueHeader*>(base); }
+
+    std::string name;
+    Role role;
+    bool owner;
+    int fd = -1;
+    void* base = nullptr;
+    size_t size = 0;
+    bool hugePages_ = false;
+    bool registered = false;
+};
@@ -0,0 +1,150 @@
+// Build: g++ -std=c++20 -O2 -march=native -pthread shm_queue_demo.cpp -o shm_queue_demo
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "benchmark_support.h"
+#include "shm_queue.h"
+
+/**
+ * Feed-to-strategy hop over a SharedQueue.
+ *
+ * 1. The same segment is consumed once by a thread of this process and once
+ *    by a forked process that attaches by name; throughput and one-way
+ *    latency should match, since both are the same cache line handoffs.
+ * 2. A forked producer is killed with SIGKILL mid-stream; the consumer
+ *    drains what it sent and then sees the producer as dead, rather than
+ *    waiting on an empty queue forever.
+ */
+
+struct Event {
+    uint64_t sendNs;
+    uint64_t seq;
+    double bid;
+    double ask;
+};
+
+using EventQueue = SharedQueue<Event, 4096>;
+
+constexpr uint64_t Items = 5'000'000;
+constexpr uint64_t LatencySamples = 100'000;
+
+uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/// Consumer side of part 1: a streaming phase, then ping-by-ping latency.
+void consume(EventQueue::Queue& queue) {
+    Event event;
+    uint64_t expected = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < Items; ++i) {
+        spinUntil([&] { return queue.dequeue(event); });
+        if (event.seq != expected++) {
+            std::fprintf(stderr, "out of sequence: %llu\n",
+                         static_cast<unsigned long long>(event.seq));
+            std::exit(1);
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::vector<uint64_t> latencies;
+    latencies.reserve(LatencySamples);
+    for (uint64_t i = 0; i < LatencySamples; ++i) {
+        spinUntil([&] { return queue.dequeue(event); });
+        latencies.push_back(nowNs() - event.sendNs);
+    }
+    std::sort(latencies.begin(), latencies.end());
+    std::printf("  %.1f M events/s, one-way latency p50 %llu ns, p99 %llu ns\n",
+                Items / elapsed.count() / 1e6,
+                static_cast<unsigned long long>(latencies[latencies.size() / 2]),
+                static_cast<unsigned long long>(latencies[latencies.size() * 99 / 100]));
+}
+
+void produce(EventQueue::Queue& queue) {
+    for (uint64_t i = 0; i < Items; ++i) {
+        Event event{0, i, 99.99, 100.01};
+        spinUntil([&] { return queue.enqueue(event); });
+    }
+    // One event in flight at a time, so each sample is a bare hop.
+    while (queue.size() != 0) {
+        std::this_thread::yield();
+    }
+    for (uint64_t i = 0; i < LatencySamples; ++i) {
+        Event event{nowNs(), i, 99.99, 100.01};
+        spinUntil([&] { return queue.enqueue(event); });
+        spinUntil([&] { return queue.size() == 0; });
+    }
+}
+
+int main() {
+    const char* name = "/lockfree_queue_demo";
+
+    {
+        EventQueue producer = EventQueue::create(name, SharedQueueRole::Producer);
+        std::printf("segment %s, huge pages: %s\n", name, producer.hugePages() ? "yes" : "no");
+
+        std::printf("consumer thread, same process:\n");
+        std::thread consumer([&] {
+            EventQueue attached = EventQueue::attach(name, SharedQueueRole::Consumer);
+            consume(attached.queue());
+        });
+        produce(producer.queue());
+        consumer.join();
+
+        std::printf("consumer process, attached by name:\n");
+        std::fflush(stdout);
+        pid_t child = fork();
+        if (child == 0) {
+            EventQueue attached = EventQueue::attach(name, SharedQueueRole::Consumer);
+            consume(attached.queue());
+            std::fflush(stdout);
+            std::_Exit(0);
+        }
+        produce(producer.queue());
+        waitpid(child, nullptr, 0);
+    }
+
+    std::printf("producer killed mid-stream:\n");
+    std::fflush(stdout);
+    EventQueue consumer = EventQueue::create(name, SharedQueueRole::Consumer);
+    pid_t child = fork();
+    if (child == 0) {
+        EventQueue producer = EventQueue::attach(name, SharedQueueRole::Producer);
+        for (uint64_t i = 0; i < 1000; ++i) {
+            spinUntil([&] { return producer.queue().enqueue(Event{nowNs(), i, 99.99, 100.01}); });
+        }
+        raise(SIGKILL);
+    }
+
+    uint64_t received = 0;
+    Event event;
+    for (;;) {
+        if (consumer.queue().dequeue(event)) {
+            ++received;
+            continue;
+        }
+        // The demo's producer is our child; reap it so its pid is released,
+        // as it would be for an unrelated process.
+        waitpid(child, nullptr, WNOHANG);
+        PeerState state = consumer.peer();
+        if (state == PeerState::Dead || state == PeerState::Exited) {
+            std::printf("  received %llu events, then the producer %s\n",
+                        static_cast<unsigned long long>(received),
+                        state == PeerState::Dead ? "died without detaching" : "exited");
+            break;
+        }
+        std::this_thread::yield();
+    }
+    return 0;
+}
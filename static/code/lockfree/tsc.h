@@ -0,0 +1,30 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/// Time stamp counter, for intervals too short for steady_clock.
+inline uint64_t readTsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+/// Nanoseconds per TSC tick, measured over ~20 ms on first use.
+inline double tscNsPerTick() {
+    static const double ratio = [] {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t startTsc = readTsc();
+        while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(20)) {
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / static_cast<double>(readTsc() - startTsc);
+    }();
+    return ratio;
+}
@@ -0,0 +1,170 @@
+// Build: g++ -std=c++20 -O2 -march=native -pthread wait_benchmark.cpp -o wait_benchmark
+// Usage: wait_benchmark [producerCpu consumerCpu]
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "benchmark_support.h"
+#include "mpmc_queue.h"
+#include "queue.h"
+#include "wait_strategy.h"
+
+/**
+ * Latency and CPU cost of the consumer wait strategies.
+ *
+ * The producer sends one timestamped item every `GapUs` microseconds, which
+ * is a quiet symbol: the consumer spends almost all its time waiting. For
+ * each strategy the table shows the one-way latency (send to dequeue) and
+ * the CPU time the consumer thread used, as a share of the wall time.
+ *
+ * A second run checks SpinThenPark's wakeup accounting under a pool: many
+ * workers share one SpinThenPark on an MPMC queue, the producer sends
+ * bursts of every size up to twice the worker count with `notify_one` per
+ * item, and pauses between bursts so the workers park. Every burst must be
+ * drained within `StrandedMs`; a lost wakeup leaves items queued behind
+ * sleeping workers and fails the run.
+ */
+
+constexpr int Samples = 20'000;
+constexpr int GapUs = 50;
+
+uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+double threadCpuSeconds() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+template <typename Wait>
+void run(const char* name, int producerCpu, int consumerCpu) {
+    LockFreeQueue<uint64_t, 1024> queue;
+    Wait wait;
+    std::vector<uint64_t> latencies(Samples);
+    double consumerCpuSeconds = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread consumer([&] {
+        pinToCpu(consumerCpu);
+        double cpuStart = threadCpuSeconds();
+        uint64_t sent;
+        for (int i = 0; i < Samples; ++i) {
+            wait.wait([&] { return queue.dequeue(sent); });
+            latencies[i] = nowNs() - sent;
+        }
+        consumerCpuSeconds = threadCpuSeconds() - cpuStart;
+    });
+
+    pinToCpu(producerCpu);
+    for (int i = 0; i < Samples; ++i) {
+        uint64_t due = nowNs() + GapUs * 1000;
+        // Sleep most of the gap, then spin to the deadline for an even pace.
+        std::this_thread::sleep_for(std::chrono::microseconds(GapUs / 2));
+        while (nowNs() < due) {
+        }
+        queue.enqueue(nowNs());
+        wait.notify();
+    }
+    consumer.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    pinToCpu(-1);
+
+    std::sort(latencies.begin(), latencies.end());
+    std::printf("%-16s %10llu %10llu %10llu %12.0f%%\n", name,
+                static_cast<unsigned long long>(latencies[Samples / 2]),
+                static_cast<unsigned long long>(latencies[Samples * 99 / 100]),
+                static_cast<unsigned long long>(latencies[Samples - 1]),
+                100.0 * consumerCpuSeconds / elapsed.count());
+}
+
+constexpr int StressWorkers = 8;
+constexpr int StressBursts = 5'000;
+constexpr int StrandedMs = 1'000;
+
+bool parkStress() {
+    MpmcQueue<uint32_t, 1024> queue;
+    SpinThenPark<16> wait; // short spin, so workers really park between bursts
+    std::atomic<uint64_t> done{0};
+    std::atomic<bool> stopping{false};
+
+    std::vector<std::thread> workers;
+    for (int w = 0; w < StressWorkers; ++w) {
+        workers.emplace_back([&] {
+            uint32_t item;
+            for (;;) {
+                bool got = false;
+                wait.wait([&] {
+                    got = queue.dequeue(item);
+                    return got || stopping.load(std::memory_order_acquire);
+                });
+                if (!got) {
+                    return;
+                }
+                done.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    std::mt19937 rng(7);
+    uint64_t sent = 0;
+    int stranded = -1;
+    for (int burst = 0; burst < StressBursts && stranded < 0; ++burst) {
+        int size = 1 + burst % (2 * StressWorkers);
+        for (int i = 0; i < size; ++i) {
+            while (!queue.enqueue(static_cast<uint32_t>(i))) {
+                std::this_thread::yield();
+            }
+            wait.notify_one();
+        }
+        sent += size;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(StrandedMs);
+        while (done.load(std::memory_order_relaxed) != sent) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                stranded = burst;
+                break;
+            }
+            std::this_thread::yield();
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(rng() % 200));
+    }
+
+    stopping.store(true, std::memory_order_release);
+    wait.notify();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (stranded >= 0) {
+        std::printf("park stress: burst %d STRANDED with %llu of %llu items done\n", stranded,
+                    static_cast<unsigned long long>(done.load()),
+                    static_cast<unsigned long long>(sent));
+        return false;
+    }
+    std::printf("park stress: %d workers, %d bursts, %llu items, none stranded\n",
+                StressWorkers, StressBursts, static_cast<unsigned long long>(sent));
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int producerCpu = argc > 2 ? std::atoi(argv[1]) : -1;
+    int consumerCpu = argc > 2 ? std::atoi(argv[2]) : -1;
+    std::printf("%u hardware threads, one item every %d us, latency in ns:\n",
+                std::thread::hardware_concurrency(), GapUs);
+    std::printf("%-16s %10s %10s %10s %13s\n", "strategy", "p50", "p99", "max", "consumer CPU");
+    run<BusySpin>("busy spin", producerCpu, consumerCpu);
+    run<PauseSpin>("pause spin", producerCpu, consumerCpu);
+    run<SpinThenYield<>>("spin then yield", producerCpu, consumerCpu);
+    run<SpinThenPark<>>("spin then park", producerCpu, consumerCpu);
+    return parkStress() ? 0 : 1;
+}
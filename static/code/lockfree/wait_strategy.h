@@ -0,0 +1,178 @@
+#pragma once
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/**
+ * How a consumer waits for a queue that is empty.
+ *
+ * Every strategy has the same two calls and works with any of the queues,
+ * since it only sees a predicate:
+ *   wait.wait([&] { return queue.dequeue(item); });   // consumer
+ *   queue.enqueue(item); wait.notify();               // producer
+ * so a deployment picks its latency / CPU trade-off with a type, without
+ * touching the queue code:
+ * - BusySpin: retries back to back. Lowest latency; burns its core forever
+ *   and, with hyperthreading, starves the sibling.
+ * - PauseSpin: the same with a pause instruction between retries, which
+ *   yields pipeline resources to the sibling hyperthread and saves power,
+ *   at a few tens of ns of extra latency.
+ * - SpinThenYield: pauses for `SpinLimit` retries, then sched_yield()s
+ *   between retries, so an oversubscribed core still makes progress. The
+ *   thread stays runnable and still shows as 100% CPU.
+ * - SpinThenPark: pauses for `SpinLimit` retries, then sleeps on a futex
+ *   until the producer signals. Idle consumers cost nothing; the first
+ *   item after a sleep pays for a wakeup (several microseconds).
+ * Only SpinThenPark does anything in `notify` (wake every sleeper) or
+ * `notify_one` (wake one, for a pool of interchangeable consumers); the
+ * others make them empty inline functions, so producers can call them
+ * unconditionally.
+ */
+
+/// One spin-loop hint: `pause` on x86, `yield` on AArch64.
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+struct BusySpin {
+    template <typename Ready>
+    void wait(Ready ready) {
+        while (!ready()) {
+        }
+    }
+
+    void notify() {}
+    void notify_one() {}
+};
+
+struct PauseSpin {
+    template <typename Ready>
+    void wait(Ready ready) {
+        while (!ready()) {
+            cpuRelax();
+        }
+    }
+
+    void notify() {}
+    void notify_one() {}
+};
+
+template <unsigned SpinLimit = 1000>
+struct SpinThenYield {
+    template <typename Ready>
+    void wait(Ready ready) {
+        for (unsigned spins = 0; !ready(); ++spins) {
+            if (spins < SpinLimit) {
+                cpuRelax();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void notify() {}
+    void notify_one() {}
+};
+
+/**
+ * Spin, then sleep on a futex.
+ *
+ * A consumer about to sleep registers in `sleepers`, re-checks its queue,
+ * and only then waits on `epoch`. The producer, after publishing, checks
+ * `sleepers` and makes the wake syscall only if someone registered. The
+ * full fence on each side (the consumer's RMW on `sleepers`, the producer's
+ * fence in `wake`) orders "publish, then check sleepers" against
+ * "register, then check the queue", so either the producer sees the sleeper
+ * or the sleeper sees the item; a wakeup cannot be lost. A wake between the
+ * re-check and the futex wait changes `epoch`, and FUTEX_WAIT then returns
+ * at once.
+ *
+ * Only the producer takes registrations off the count, one per consumer
+ * it wakes (all of them for `notify`): a woken consumer may not get a core
+ * for a while, and until it does, further publishes see no sleeper and make
+ * no syscall. A consumer that finds an item on its re-check leaves its
+ * registration in place. Taking it off there could remove one a producer
+ * already consumed on its behalf while another consumer was registering,
+ * leaving that one asleep uncounted with work queued. So the count only
+ * ever runs high: each wake either reaches a sleeper, or advances `epoch`
+ * so that every consumer between registering and FUTEX_WAIT returns at
+ * once, or uses up a stale registration at the cost of one spare syscall.
+ *
+ * The producer's cost when nobody sleeps is that fence and one load of a
+ * line the consumer writes only when it goes to sleep. Any number of
+ * consumers may share one SpinThenPark. `notify_one` is enough when any
+ * consumer can take any item, as in a pool of workers. The futex is
+ * process-private, so this does not work across a SharedQueue.
+ */
+template <unsigned SpinLimit = 1000>
+class SpinThenPark {
+public:
+    template <typename Ready>
+    void wait(Ready ready) {
+        for (unsigned spins = 0; spins < SpinLimit; ++spins) {
+            if (ready()) {
+                return;
+            }
+            cpuRelax();
+        }
+        for (;;) {
+            uint32_t seen = epoch.load(std::memory_order_acquire);
+            sleepers.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (ready()) {
+                return; // the registration stays, for a producer to take off
+            }
+            syscall(SYS_futex, &epoch, FUTEX_WAIT_PRIVATE, seen, nullptr, nullptr, 0);
+            if (ready()) {
+                return;
+            }
+        }
+    }
+
+    /// Producer, after each publish (or once after a bulk publish).
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_relaxed) != 0 &&
+            sleepers.exchange(0, std::memory_order_relaxed) != 0) {
+            wake(INT_MAX);
+        }
+    }
+
+    /// Producer, after publishing one item that any consumer may take.
+    void notify_one() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint32_t count = sleepers.load(std::memory_order_relaxed);
+        while (count != 0) {
+            if (sleepers.compare_exchange_weak(count, count - 1, std::memory_order_relaxed)) {
+                wake(1);
+                return;
+            }
+        }
+    }
+
+private:
+    void wake(int count) {
+        epoch.fetch_add(1, std::memory_order_release);
+        syscall(SYS_futex, &epoch, FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+    }
+
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+                  "FUTEX_WAIT needs a plain 32-bit word");
+
+    std::atomic<uint32_t> epoch{0};
+    std::atomic<uint32_t> sleepers{0};
+};
@@ -0,0 +1,200 @@
+// Build: g++ -std=c++20 -O2 -march=native -pthread fork_join_benchmark.cpp -o fork_join_benchmark
+// Usage: fork_join_benchmark [workers]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "work_stealing_pool.h"
+
+/**
+ * Recursive fork-join on two work-stealing pools.
+ *
+ * fib(n) forks fib(n - 1) as a task, computes fib(n - 2) itself and joins
+ * the child by running other tasks until it is done; below `Cutoff` it
+ * recurses serially. That makes a deep, unbalanced tree of small tasks,
+ * where every join depends on stealing. It runs on:
+ * - the WorkQueue pool of work_stealing_threadpool.md (a std::deque of
+ *   std::function behind a mutex per worker, kept below as it is there,
+ *   with the submit / helpUntil interface added),
+ * - WorkStealingPool (Chase-Lev deques, random victims, recycled tasks),
+ * for a coarse and a fine cutoff, against the serial time.
+ */
+
+namespace baseline {
+
+using Task = std::function<void()>;
+
+class WorkQueue {
+private:
+    std::deque<Task> taskQueue;
+    std::mutex queueMutex;
+
+public:
+    void push(Task task) {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        taskQueue.push_back(std::move(task));
+    }
+
+    std::optional<Task> pop() {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (taskQueue.empty()) return std::nullopt;
+        Task task = std::move(taskQueue.back());
+        taskQueue.pop_back();
+        return task;
+    }
+
+    std::optional<Task> steal() {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (taskQueue.empty()) return std::nullopt;
+        Task task = std::move(taskQueue.front());
+        taskQueue.pop_front();
+        return task;
+    }
+};
+
+class MutexStealingPool {
+public:
+    explicit MutexStealingPool(size_t threads) : queues(threads) {
+        for (size_t i = 0; i < threads; ++i) {
+            workers.emplace_back([this, i] { workerFunction(i); });
+        }
+    }
+
+    ~MutexStealingPool() {
+        shutdownFlag = true;
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    template <typename F>
+    void submit(F&& function) {
+        size_t index = workerId >= 0 ? workerId : next++ % queues.size();
+        queues[index].push(std::forward<F>(function));
+    }
+
+    template <typename Done>
+    void helpUntil(Done done) {
+        while (!done()) {
+            if (std::optional<Task> task = findWork()) {
+                (*task)();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+    std::optional<Task> findWork() {
+        std::optional<Task> task;
+        if (workerId >= 0) {
+            task = queues[workerId].pop();
+        }
+        for (size_t i = 0; !task && i < queues.size(); ++i) {
+            if (static_cast<int>(i) != workerId) {
+                task = queues[i].steal();
+            }
+        }
+        return task;
+    }
+
+    void workerFunction(size_t index) {
+        workerId = static_cast<int>(index);
+        while (!shutdownFlag) {
+            if (std::optional<Task> task = findWork()) {
+                (*task)();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        workerId = -1;
+    }
+
+    inline static thread_local int workerId = -1;
+    std::vector<WorkQueue> queues;
+    std::vector<std::thread> workers;
+    std::atomic<bool> shutdownFlag{false};
+    std::atomic<size_t> next{0};
+};
+
+} // namespace baseline
+
+constexpr int N = 32;
+
+uint64_t fibSerial(int n) { return n < 2 ? n : fibSerial(n - 1) + fibSerial(n - 2); }
+
+template <typename Pool>
+uint64_t fib(Pool& pool, int n, int cutoff, std::atomic<uint64_t>& tasks) {
+    if (n < cutoff) {
+        return fibSerial(n);
+    }
+    std::atomic<bool> ready{false};
+    uint64_t left = 0;
+    tasks.fetch_add(1, std::memory_order_relaxed);
+    pool.submit([&pool, &ready, &left, &tasks, n, cutoff] {
+        left = fib(pool, n - 1, cutoff, tasks);
+        ready.store(true, std::memory_order_release);
+    });
+    uint64_t right = fib(pool, n - 2, cutoff, tasks);
+    pool.helpUntil([&] { return ready.load(std::memory_order_acquire); });
+    return left + right;
+}
+
+template <typename Pool>
+double seconds(Pool& pool, int cutoff, uint64_t expected, uint64_t& tasks) {
+    std::atomic<uint64_t> spawned{0};
+    auto start = std::chrono::steady_clock::now();
+    uint64_t result = fib(pool, N, cutoff, spawned);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (result != expected) {
+        std::fprintf(stderr, "fib(%d) = %llu, expected %llu\n", N,
+                     static_cast<unsigned long long>(result),
+                     static_cast<unsigned long long>(expected));
+        std::exit(1);
+    }
+    tasks = spawned.load();
+    return elapsed.count();
+}
+
+int main(int argc, char** argv) {
+    size_t workers = argc > 1 ? std::strtoul(argv[1], nullptr, 10)
+                              : std::max(2u, std::thread::hardware_concurrency());
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t expected = fibSerial(N);
+    std::chrono::duration<double> serial = std::chrono::steady_clock::now() - start;
+    std::printf("%u hardware threads, %zu workers, fib(%d): serial %.1f ms\n",
+                std::thread::hardware_concurrency(), workers, N, serial.count() * 1e3);
+    std::printf("%-8s %10s %22s %22s %10s\n", "cutoff", "tasks", "mutex WorkQueue ms",
+                "Chase-Lev ms", "steals");
+
+    for (int cutoff : {20, 12}) {
+        uint64_t tasks = 0;
+        double locked;
+        {
+            baseline::MutexStealingPool pool(workers);
+            locked = seconds(pool, cutoff, expected, tasks);
+        }
+        double lockFree;
+        uint64_t steals;
+        {
+            WorkStealingPool pool(workers);
+            lockFree = seconds(pool, cutoff, expected, tasks);
+            steals = pool.steals();
+        }
+        std::printf("%-8d %10llu %22.1f %22.1f %10llu\n", cutoff,
+                    static_cast<unsigned long long>(tasks), locked * 1e3, lockFree * 1e3,
+                    static_cast<unsigned long long>(steals));
+    }
+    return 0;
+}
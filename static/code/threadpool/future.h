@@ -0,0 +1,263 @@
+#pragma once
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "../lockfree/wait_strategy.h"
+#include "thread_local_pool.h"
+
+/**
+ * One-shot Promise / Future pair whose shared state comes from a
+ * per-thread pool, for returning results from pool tasks.
+ *
+ * std::packaged_task allocates its shared state, and the ThreadPool of
+ * threadPool_with_future_and_promise.md puts it in a shared_ptr inside a
+ * std::function: threadpool_benchmark counts four mallocs per task. Here:
+ * - the state (status, reference count, result) comes from a
+ *   ThreadLocalPool, so a thread that keeps a bounded number of futures in
+ *   flight stops allocating once its free list has warmed up,
+ * - Promise and Future are one pointer each, so `withFuture(f)` wraps a
+ *   callable in one pointer more, and a small lambda with its promise
+ *   still fits an InplaceTask<>,
+ * - `get` spins briefly, then sleeps on a futex, and the promise makes the
+ *   wake syscall only if the future is actually asleep.
+ * Errors follow std::future: an exception thrown by the task is rethrown
+ * by `get`, and a promise dropped unfulfilled gives broken_promise.
+ */
+template <typename T>
+class Future;
+
+template <typename T>
+class Promise;
+
+namespace detail {
+
+template <typename T>
+class SharedState {
+public:
+    using Value = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+    enum Status : uint32_t { Pending, Sleeping, HasValue, HasError };
+
+    SharedState() = default;
+    SharedState(const SharedState&) = delete;
+    SharedState& operator=(const SharedState&) = delete;
+
+    ~SharedState() {
+        if (status.load(std::memory_order_relaxed) == HasValue) {
+            std::destroy_at(value());
+        }
+    }
+
+    template <typename... Args>
+    void setValue(Args&&... args) {
+        ::new (storage) Value(std::forward<Args>(args)...);
+        publish(HasValue);
+    }
+
+    void setError(std::exception_ptr exception) {
+        error = std::move(exception);
+        publish(HasError);
+    }
+
+    bool ready() const { return status.load(std::memory_order_acquire) >= HasValue; }
+
+    void wait() {
+        for (unsigned spins = 0; spins < 1000; ++spins) {
+            if (ready()) {
+                return;
+            }
+            cpuRelax();
+        }
+        uint32_t seen = Pending;
+        status.compare_exchange_strong(seen, Sleeping, std::memory_order_acquire);
+        while (!ready()) {
+            syscall(SYS_futex, &status, FUTEX_WAIT_PRIVATE, Sleeping, nullptr, nullptr, 0);
+        }
+    }
+
+    /// After `wait`: moves the value out, or rethrows the error.
+    T take() {
+        if (status.load(std::memory_order_relaxed) == HasError) {
+            std::rethrow_exception(error);
+        }
+        if constexpr (!std::is_void_v<T>) {
+            return std::move(*value());
+        }
+    }
+
+    /// Promise side, once: adds the future's reference to the promise's.
+    void attachFuture() {
+        if (retrieved) {
+            throw std::future_error(std::future_errc::future_already_retrieved);
+        }
+        retrieved = true;
+        references.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// Called once by the promise and once by its future, if it has one.
+    static void release(SharedState* state) {
+        if (state->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            ThreadLocalPool<SharedState>::destroy(state);
+        }
+    }
+
+private:
+    Value* value() { return std::launder(reinterpret_cast<Value*>(storage)); }
+
+    void publish(Status result) {
+        if (status.exchange(result, std::memory_order_acq_rel) == Sleeping) {
+            syscall(SYS_futex, &status, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+        }
+    }
+
+    std::atomic<uint32_t> status{Pending};
+    std::atomic<uint32_t> references{1};
+    std::exception_ptr error;
+    bool retrieved = false;
+    alignas(Value) unsigned char storage[sizeof(Value)];
+};
+
+} // namespace detail
+
+template <typename T>
+class Future {
+public:
+    Future() = default;
+    Future(Future&& other) noexcept : state(std::exchange(other.state, nullptr)) {}
+
+    Future& operator=(Future&& other) noexcept {
+        if (this != &other) {
+            reset();
+            state = std::exchange(other.state, nullptr);
+        }
+        return *this;
+    }
+
+    ~Future() { reset(); }
+
+    bool valid() const { return state != nullptr; }
+
+    /// Whether `get` would return without waiting.
+    bool ready() const { return state->ready(); }
+
+    void wait() const { state->wait(); }
+
+    /// Waits for the result and takes it; the future is then invalid.
+    T get() {
+        State* taken = std::exchange(state, nullptr);
+        struct Release {
+            State* state;
+            ~Release() { State::release(state); }
+        } release{taken};
+        taken->wait();
+        return taken->take();
+    }
+
+private:
+    using State = detail::SharedState<T>;
+
+    friend class Promise<T>;
+
+    explicit Future(State* state) : state(state) {}
+
+    void reset() {
+        if (state != nullptr) {
+            State::release(std::exchange(state, nullptr));
+        }
+    }
+
+    State* state = nullptr;
+};
+
+template <typename T>
+class Promise {
+public:
+    /// Takes the shared state from the calling thread's pool.
+    Promise() : state(ThreadLocalPool<State>::create()) {}
+
+    Promise(Promise&& other) noexcept : state(std::exchange(other.state, nullptr)) {}
+
+    Promise& operator=(Promise&& other) noexcept {
+        if (this != &other) {
+            reset();
+            state = std::exchange(other.state, nullptr);
+        }
+        return *this;
+    }
+
+    ~Promise() { reset(); }
+
+    /// Once per promise.
+    Future<T> get_future() {
+        state->attachFuture();
+        return Future<T>(state);
+    }
+
+    template <typename... Args>
+    void set_value(Args&&... args) {
+        satisfiable()->setValue(std::forward<Args>(args)...);
+        State::release(std::exchange(state, nullptr));
+    }
+
+    void set_exception(std::exception_ptr exception) {
+        satisfiable()->setError(std::move(exception));
+        State::release(std::exchange(state, nullptr));
+    }
+
+private:
+    using State = detail::SharedState<T>;
+
+    State* satisfiable() {
+        if (state == nullptr) {
+            throw std::future_error(std::future_errc::promise_already_satisfied);
+        }
+        return state;
+    }
+
+    void reset() {
+        if (state != nullptr) {
+            state->setError(std::make_exception_ptr(
+                std::future_error(std::future_errc::broken_promise)));
+            State::release(std::exchange(state, nullptr));
+        }
+    }
+
+    State* state;
+};
+
+/**
+ * Wraps `function` so that running the wrapper fulfils a promise with its
+ * result, or its exception; returns the wrapper and the matching future.
+ */
+template <typename F>
+auto withFuture(F&& function) {
+    using Result = std::invoke_result_t<std::decay_t<F>&>;
+    Promise<Result> promise;
+    Future<Result> future = promise.get_future();
+    auto task = [function = std::forward<F>(function), promise = std::move(promise)]() mutable {
+        try {
+            if constexpr (std::is_void_v<Result>) {
+                function();
+                promise.set_value();
+            } else {
+                promise.set_value(function());
+            }
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+        }
+    };
+    return std::pair{std::move(task), std::move(future)};
+}
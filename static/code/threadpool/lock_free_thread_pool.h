@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../lockfree/mpmc_queue.h"
+#include "../lockfree/wait_strategy.h"
+#include "future.h"
+#include "task.h"
+
+/**
+ * Fixed-size thread pool with no locks on the submit or execute path.
+ *
+ * - Tasks go through a bounded MpmcQueue of InplaceTask<> slots: submitters
+ *   claim a position with one CAS, workers claim one with another, and
+ *   neither ever blocks the other. A callable of more than 48 bytes does not
+ *   compile, so submitting never allocates, and a slot (sequence number
+ *   plus task) is one cache line. `async` returns a pooled Future, and
+ *   allocates nothing either once the submitting thread's pool is warm.
+ * - Idle workers wait with `Wait` (SpinThenPark by default): they spin
+ *   briefly, then sleep on a futex. A submit wakes one sleeper, and makes
+ *   the wake syscall only when some worker is actually asleep, so a busy
+ *   pool pays one fence per submit for the wakeup machinery.
+ * - The queue is bounded: `try_submit` fails when it is full, and `submit`
+ *   yields until there is room, which pushes back on submitters instead of
+ *   growing without limit.
+ * - The destructor runs every task already submitted, then joins.
+ * A task that throws terminates the process, as with std::thread.
+ */
+template <size_t Capacity = 4096, typename Wait = SpinThenPark<>>
+class LockFreeThreadPool {
+public:
+    using Job = InplaceTask<>;
+
+    explicit LockFreeThreadPool(size_t threads) : tasks(std::make_unique<Queue>()) {
+        workers.reserve(threads);
+        for (size_t i = 0; i < threads; ++i) {
+            workers.emplace_back([this] { workerThread(); });
+        }
+    }
+
+    LockFreeThreadPool(const LockFreeThreadPool&) = delete;
+    LockFreeThreadPool& operator=(const LockFreeThreadPool&) = delete;
+
+    ~LockFreeThreadPool() {
+        stopping.store(true, std::memory_order_release);
+        wait.notify();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    /// Any thread; false if the queue is full.
+    template <typename F>
+    bool try_submit(F&& function) {
+        if (!tasks->emplace(std::forward<F>(function))) {
+            return false;
+        }
+        wait.notify_one();
+        return true;
+    }
+
+    /// Any thread; yields while the queue is full.
+    template <typename F>
+    void submit(F&& function) {
+        Job job(std::forward<F>(function));
+        while (!tasks->enqueue(std::move(job))) {
+            std::this_thread::yield();
+        }
+        wait.notify_one();
+    }
+
+    /// Any thread; like `submit`, and returns a Future for the result.
+    template <typename F>
+    auto async(F&& function) {
+        auto [task, future] = withFuture(std::forward<F>(function));
+        submit(std::move(task));
+        return std::move(future);
+    }
+
+    size_t threads() const { return workers.size(); }
+
+private:
+    using Queue = MpmcQueue<Job, Capacity>;
+
+    void workerThread() {
+        Job job;
+        for (;;) {
+            wait.wait([&] {
+                return tasks->dequeue(job) || stopping.load(std::memory_order_acquire);
+            });
+            if (!job) {
+                break; // Stopping, and the queue looked empty
+            }
+            job();
+            job = Job();
+        }
+        // Tasks submitted before the destructor ran, seen after `stopping`.
+        while (tasks->dequeue(job)) {
+            job();
+        }
+    }
+
+    std::unique_ptr<Queue> tasks;
+    Wait wait;
+    std::atomic<bool> stopping{false};
+    std::vector<std::thread> workers;
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Move-only `void()` callable with inline storage, for task queues.
+ *
+ * std::function must be copyable and, in libstdc++, keeps only 16 bytes
+ * inline, so a lambda capturing three pointers costs a malloc and a free per
+ * task. Task<InlineSize> keeps any callable of up to `InlineSize` bytes
+ * (that is nothrow move constructible) inside the object, and boxes larger
+ * ones on the heap, so the common case allocates nothing and the rest still
+ * works. Being move-only, it also accepts callables that own resources
+ * (a unique_ptr, a promise).
+ *
+ * Dispatch goes through one static table of function pointers per callable
+ * type, as std::function does, so a Task is its storage plus one pointer:
+ * 56 bytes by default, which with a queue's 8-byte sequence number makes one
+ * cache line per slot. Storage is pointer-aligned; a callable that needs
+ * more alignment is boxed.
+ *
+ * InplaceTask<InlineSize> is the same type with the heap fallback removed:
+ * a callable that does not fit inline is a compile error instead of a
+ * malloc, so code that must not allocate per task can say so in its type.
+ */
+template <size_t InlineSize = 48, bool HeapFallback = true>
+class Task {
+    static_assert(InlineSize >= sizeof(void*) && InlineSize % alignof(void*) == 0);
+
+    template <typename F>
+    static constexpr bool fitsInline = sizeof(F) <= InlineSize &&
+                                       alignof(F) <= alignof(void*) &&
+                                       std::is_nothrow_move_constructible_v<F>;
+
+public:
+    Task() = default;
+
+    template <typename F>
+        requires(!std::is_same_v<std::decay_t<F>, Task> && std::is_invocable_v<std::decay_t<F>&>)
+    Task(F&& function) {
+        using Callable = std::decay_t<F>;
+        if constexpr (fitsInline<Callable>) {
+            ::new (storage) Callable(std::forward<F>(function));
+            ops = &inlineOps<Callable>;
+        } else {
+            static_assert(HeapFallback && sizeof(Callable) > 0,
+                          "InplaceTask: the callable must be at most InlineSize bytes, "
+                          "pointer-aligned and nothrow move constructible");
+            ::new (storage) Callable*(new Callable(std::forward<F>(function)));
+            ops = &boxedOps<Callable>;
+        }
+    }
+
+    Task(Task&& other) noexcept {
+        if (other.ops != nullptr) {
+            other.ops->move(other.storage, storage);
+            ops = std::exchange(other.ops, nullptr);
+        }
+    }
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            if (other.ops != nullptr) {
+                other.ops->move(other.storage, storage);
+                ops = std::exchange(other.ops, nullptr);
+            }
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() { reset(); }
+
+    void operator()() { ops->invoke(storage); }
+
+    explicit operator bool() const { return ops != nullptr; }
+
+    /// Whether a callable of type F is stored without a heap allocation.
+    template <typename F>
+    static constexpr bool storedInline() {
+        return fitsInline<std::decay_t<F>>;
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void* storage);
+        void (*move)(void* from, void* to) noexcept; // leaves `from` destroyed
+        void (*destroy)(void* storage) noexcept;
+    };
+
+    template <typename Callable>
+    static constexpr Ops inlineOps{
+        [](void* storage) { (*std::launder(static_cast<Callable*>(storage)))(); },
+        [](void* from, void* to) noexcept {
+            Callable* source = std::launder(static_cast<Callable*>(from));
+            ::new (to) Callable(std::move(*source));
+            source->~Callable();
+        },
+        [](void* storage) noexcept { std::launder(static_cast<Callable*>(storage))->~Callable(); },
+    };
+
+    template <typename Callable>
+    static constexpr Ops boxedOps{
+        [](void* storage) { (**std::launder(static_cast<Callable**>(storage)))(); },
+        [](void* from, void* to) noexcept {
+            ::new (to) Callable*(*std::launder(static_cast<Callable**>(from)));
+        },
+        [](void* storage) noexcept { delete *std::launder(static_cast<Callable**>(storage)); },
+    };
+
+    void reset() {
+        if (ops != nullptr) {
+            ops->destroy(storage);
+            ops = nullptr;
+        }
+    }
+
+    alignas(void*) unsigned char storage[InlineSize];
+    const Ops* ops = nullptr;
+};
+
+template <size_t InlineSize = 48>
+using InplaceTask = Task<InlineSize, false>;
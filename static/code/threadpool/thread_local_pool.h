@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+/**
+ * Per-thread free list of blocks sized for a T, for objects created and
+ * destroyed at task rate (task nodes, promise/future states).
+ *
+ * Every block belongs to the thread whose `create` first allocated it, and
+ * a header in front of the T records which. `destroy` on the owning thread
+ * puts the block back on its free list with no atomic; `destroy` anywhere
+ * else pushes it, with one CAS, onto the owner's remote list, which the
+ * owner takes over whole when its free list runs dry. Blocks therefore
+ * never drift to the thread that happens to release them: a submitter
+ * whose objects are always destroyed by workers reuses its own blocks
+ * rather than allocating while the workers' lists grow. Once a thread has
+ * as many blocks as it keeps in flight, creating a T costs no allocation.
+ *
+ * When a thread exits, its free blocks go back to the heap; a block still
+ * in use elsewhere is freed by whichever thread destroys it, and the last
+ * one frees the exited thread's bookkeeping.
+ */
+template <typename T>
+class ThreadLocalPool {
+public:
+    template <typename... Args>
+    static T* create(Args&&... args) {
+        void* block = take();
+        try {
+            return ::new (block) T(std::forward<Args>(args)...);
+        } catch (...) {
+            give(block);
+            throw;
+        }
+    }
+
+    static void destroy(T* object) noexcept {
+        std::destroy_at(object);
+        give(object);
+    }
+
+private:
+    struct Link {
+        Link* next;
+    };
+
+    struct Cache {
+        Link* free = nullptr;                  // owner thread only
+        std::atomic<Link*> remote{nullptr};    // pushed by other threads; &Closed once the owner exits
+        std::atomic<size_t> references{1};     // the owner thread, plus each block allocated for it
+    };
+
+    static constexpr size_t BlockAlign = std::max({alignof(T), alignof(Link), alignof(Cache*)});
+    // The owner pointer sits this far in front of the object.
+    static constexpr size_t HeaderSize = (sizeof(Cache*) + BlockAlign - 1) / BlockAlign * BlockAlign;
+    static constexpr size_t BlockSize = HeaderSize + std::max(sizeof(T), sizeof(Link));
+
+    inline static Link Closed{nullptr};
+
+    static Cache*& ownerOf(void* block) {
+        return *reinterpret_cast<Cache**>(static_cast<unsigned char*>(block) - HeaderSize);
+    }
+
+    static void* allocate(Cache& cache) {
+        void* memory;
+        if constexpr (BlockAlign > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            memory = ::operator new(BlockSize, std::align_val_t{BlockAlign});
+        } else {
+            memory = ::operator new(BlockSize);
+        }
+        void* block = static_cast<unsigned char*>(memory) + HeaderSize;
+        ::new (static_cast<unsigned char*>(memory)) Cache*(&cache);
+        cache.references.fetch_add(1, std::memory_order_relaxed);
+        return block;
+    }
+
+    static void deallocate(void* block) noexcept {
+        void* memory = static_cast<unsigned char*>(block) - HeaderSize;
+        if constexpr (BlockAlign > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            ::operator delete(memory, std::align_val_t{BlockAlign});
+        } else {
+            ::operator delete(memory);
+        }
+    }
+
+    /// Drops `count` references to `cache`; the last one frees it.
+    static void release(Cache* cache, size_t count) noexcept {
+        if (cache->references.fetch_sub(count, std::memory_order_acq_rel) == count) {
+            delete cache;
+        }
+    }
+
+    /// The calling thread's cache, created on first use and closed at exit.
+    struct Owner {
+        Cache* cache = nullptr;
+
+        ~Owner() {
+            if (cache == nullptr) {
+                return;
+            }
+            // After this exchange, other threads free our blocks themselves.
+            Link* remote = cache->remote.exchange(&Closed, std::memory_order_acquire);
+            size_t freed = 0;
+            for (Link* list : {cache->free, remote}) {
+                while (list != nullptr) {
+                    deallocate(std::exchange(list, list->next));
+                    ++freed;
+                }
+            }
+            release(cache, freed + 1);
+        }
+    };
+
+    static Owner& owner() {
+        thread_local Owner owner;
+        return owner;
+    }
+
+    static void* take() {
+        Owner& self = owner();
+        if (self.cache == nullptr) {
+            self.cache = new Cache;
+        }
+        Cache& cache = *self.cache;
+        if (cache.free == nullptr) {
+            cache.free = cache.remote.exchange(nullptr, std::memory_order_acquire);
+            if (cache.free == nullptr) {
+                return allocate(cache);
+            }
+        }
+        return std::exchange(cache.free, cache.free->next);
+    }
+
+    static void give(void* block) noexcept {
+        Cache* cache = ownerOf(block);
+        if (cache == owner().cache) {
+            cache->free = ::new (block) Link{cache->free};
+            return;
+        }
+        Link* head = cache->remote.load(std::memory_order_relaxed);
+        do {
+            if (head == &Closed) {
+                deallocate(block);
+                release(cache, 1);
+                return;
+            }
+        } while (!cache->remote.compare_exchange_weak(head, ::new (block) Link{head},
+                                                      std::memory_order_release,
+                                                      std::memory_order_relaxed));
+    }
+};
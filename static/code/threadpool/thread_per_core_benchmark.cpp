@@ -0,0 +1,223 @@
+// Build: g++ -std=c++20 -O2 -march=native -pthread thread_per_core_benchmark.cpp -o thread_per_core_benchmark
+// Usage: thread_per_core_benchmark [--cpus LIST]
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "thread_per_core_pool.h"
+
+/**
+ * Symbol-partitioned updates on a thread-per-core pool.
+ *
+ * One feed thread sends `Events` book updates for `Symbols` symbols, each
+ * book 4 KB of price levels. They run:
+ * - on the ThreadPool of thread_per_core_pool.md, round-robin, with a mutex
+ *   per book since any worker may update any book. It is kept below as it
+ *   is there, with three changes needed to build and stop it: the
+ *   per-queue vectors are sized in the constructor (std::vector<std::mutex>
+ *   cannot be resized), a stolen task is unwrapped from its optional, and
+ *   `stop` is set under each queue's mutex so no worker misses it.
+ * - on ThreadPerCorePool, round-robin with the same mutexes, which isolates
+ *   the queues, pinning and task type,
+ * - on ThreadPerCorePool routed by symbol, with no locks, where each book
+ *   stays in one core's cache.
+ * Each update counts itself in its book, and the run ends when the counts
+ * add up to `Events`.
+ */
+
+namespace baseline {
+
+class ThreadPool {
+public:
+    ThreadPool(size_t num_threads);
+    ~ThreadPool();
+
+    void submit(std::function<void()> task);
+
+private:
+    void worker_thread(int index);
+    std::optional<std::function<void()>> steal_task(int thief_index);
+
+    std::vector<std::thread> workers;
+    std::vector<std::queue<std::function<void()>>> task_queues;
+    std::vector<std::mutex> queue_mutexes;
+    std::atomic<bool> stop;
+    std::vector<std::condition_variable> queue_conds;
+};
+
+ThreadPool::ThreadPool(size_t num_threads)
+    : task_queues(num_threads), queue_mutexes(num_threads), stop(false),
+      queue_conds(num_threads) {
+    for (size_t i = 0; i < num_threads; ++i) {
+        workers.emplace_back(&ThreadPool::worker_thread, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    for (auto& mutex : queue_mutexes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    for (auto& cond : queue_conds) cond.notify_all();
+    for (auto& worker : workers) worker.join();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    static size_t index = 0;
+    size_t thread_index = index++ % workers.size();
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutexes[thread_index]);
+        task_queues[thread_index].push(std::move(task));
+    }
+    queue_conds[thread_index].notify_one();
+}
+
+void ThreadPool::worker_thread(int index) {
+    while (!stop) {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(queue_mutexes[index]);
+            queue_conds[index].wait(lock, [&] { return stop || !task_queues[index].empty(); });
+
+            if (stop) return;
+            if (!task_queues[index].empty()) {
+                task = std::move(task_queues[index].front());
+                task_queues[index].pop();
+            }
+        }
+
+        if (task) {
+            task();  // Execute the task
+        } else {
+            // Try stealing work
+            std::optional<std::function<void()>> stolen = steal_task(index);
+            if (stolen) (*stolen)();
+        }
+    }
+}
+
+std::optional<std::function<void()>> ThreadPool::steal_task(int thief_index) {
+    for (size_t i = 0; i < workers.size(); ++i) {
+        if (static_cast<int>(i) == thief_index) continue;
+
+        std::lock_guard<std::mutex> lock(queue_mutexes[i]);
+        if (!task_queues[i].empty()) {
+            auto task = std::move(task_queues[i].front());
+            task_queues[i].pop();
+            return task;
+        }
+    }
+    return std::nullopt;
+}
+
+} // namespace baseline
+
+constexpr uint64_t Events = 1'000'000;
+constexpr size_t Symbols = 256;
+constexpr size_t Levels = 512;
+
+struct alignas(CacheLineSize) Book {
+    std::array<int64_t, Levels> quantity{};
+    std::atomic<uint64_t> applied{0};
+    std::mutex lock;
+};
+
+void apply(Book& book, uint32_t level, int64_t delta) {
+    book.quantity[level] += delta;
+    book.quantity[(level + 1) % Levels] -= delta / 2;
+    book.applied.fetch_add(1, std::memory_order_relaxed);
+}
+
+/// Feeds `Events` updates through `submit(symbol, book, level, delta)` and
+/// returns millions of updates per second.
+template <typename Submit>
+double run(std::vector<std::unique_ptr<Book>>& books, Submit submit) {
+    for (auto& book : books) {
+        book->applied.store(0, std::memory_order_relaxed);
+    }
+    auto start = std::chrono::steady_clock::now();
+    uint64_t state = 88172645463325252ull;
+    for (uint64_t i = 0; i < Events; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        size_t symbol = state % Symbols;
+        submit(symbol, books[symbol].get(), static_cast<uint32_t>((state >> 16) % Levels),
+               static_cast<int64_t>((state >> 32) % 200) - 100);
+    }
+    for (;;) {
+        uint64_t applied = 0;
+        for (auto& book : books) {
+            applied += book->applied.load(std::memory_order_relaxed);
+        }
+        if (applied == Events) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return Events / elapsed.count() / 1e6;
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> cpus = allowedCpus();
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--cpus") == 0 && i + 1 < argc) {
+            cpus = parseCpuList(argv[++i]);
+        }
+    }
+
+    std::vector<std::unique_ptr<Book>> books;
+    for (size_t s = 0; s < Symbols; ++s) {
+        books.push_back(std::make_unique<Book>());
+    }
+
+    std::printf("%zu workers, %zu symbols, %llu updates per run\n", cpus.size(), Symbols,
+                static_cast<unsigned long long>(Events));
+    double locked;
+    {
+        baseline::ThreadPool pool(cpus.size());
+        locked = run(books, [&](size_t, Book* book, uint32_t level, int64_t delta) {
+            pool.submit([book, level, delta] {
+                std::lock_guard<std::mutex> guard(book->lock);
+                apply(*book, level, delta);
+            });
+        });
+    }
+    double roundRobin;
+    double routed;
+    {
+        ThreadPerCorePool<> pool(cpus);
+        for (size_t i = 0; i < pool.threads(); ++i) {
+            std::printf("worker %zu: cpu %d, node %d\n", i, pool.cpu(i), pool.node(i));
+        }
+        size_t next = 0;
+        roundRobin = run(books, [&](size_t, Book* book, uint32_t level, int64_t delta) {
+            pool.submitTo(next++ % pool.threads(), [book, level, delta] {
+                std::lock_guard<std::mutex> guard(book->lock);
+                apply(*book, level, delta);
+            });
+        });
+        routed = run(books, [&](size_t symbol, Book* book, uint32_t level, int64_t delta) {
+            pool.submit(symbol, [book, level, delta] { apply(*book, level, delta); });
+        });
+    }
+    std::printf("%-44s %12s\n", "pool", "M updates/s");
+    std::printf("%-44s %12.2f\n", "per-queue mutex + condvar, round-robin", locked);
+    std::printf("%-44s %12.2f\n", "thread-per-core, round-robin + book mutex", roundRobin);
+    std::printf("%-44s %12.2f\n", "thread-per-core, routed by symbol", routed);
+    return 0;
+}
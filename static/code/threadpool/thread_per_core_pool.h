@@ -0,0 +1,190 @@
+#pragma once
+
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <latch>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../lockfree/cpu_affinity.h"
+#include "../lockfree/mpmc_queue.h"
+#include "../lockfree/wait_strategy.h"
+#include "future.h"
+#include "task.h"
+
+/**
+ * Thread-per-core executor: one pinned worker per CPU, each with its own
+ * queue and scratch memory on its own NUMA node, and tasks routed by key.
+ *
+ * - Workers run on the CPUs given (by default every CPU in the process's
+ *   cpuset, as taskset or a cgroup set it), one worker per entry, pinned
+ *   for life, so the scheduler never moves a worker away from its cache. A
+ *   CPU outside the cpuset throws std::invalid_argument.
+ * - Each worker allocates its MpscQueue and its scratch buffer itself,
+ *   after pinning and switching its memory policy to MPOL_LOCAL, and
+ *   touches every page. Pages are placed on first touch, so both end up on
+ *   the worker's node without libnuma; the constructor returns once every
+ *   worker is ready.
+ * - `submit(key, f)` always sends the same key to the same worker
+ *   (std::hash of the key modulo the worker count, so small integer ids
+ *   spread evenly). Work partitioned by key, such as per-symbol state, is
+ *   then only ever touched by one core and needs no lock. `submitTo(i, f)`
+ *   picks the worker directly.
+ * - There is no stealing, which would break that affinity: a hot key loads
+ *   its worker and no other.
+ * - Idle workers spin, then park on their own SpinThenPark; a submit wakes
+ *   the one worker it sent the task to.
+ * - Tasks are InplaceTask<>, so submitting never allocates; `async(key, f)`
+ *   returns a Future whose state comes from the submitter's pool.
+ * The destructor runs every task already submitted, then joins.
+ */
+template <size_t Capacity = 4096>
+class ThreadPerCorePool {
+public:
+    using Job = InplaceTask<>;
+
+    explicit ThreadPerCorePool(std::vector<int> cpus = allowedCpus(),
+                               size_t scratchBytes = 1 << 20) {
+        if (cpus.empty()) {
+            throw std::invalid_argument("ThreadPerCorePool needs at least one cpu");
+        }
+        std::vector<int> allowed = allowedCpus();
+        for (int cpu : cpus) {
+            if (std::find(allowed.begin(), allowed.end(), cpu) == allowed.end()) {
+                throw std::invalid_argument("cpu " + std::to_string(cpu) +
+                                            " is not in this process's cpuset");
+            }
+        }
+        for (int cpu : cpus) {
+            workers.push_back(std::make_unique<Worker>());
+            workers.back()->cpu = cpu;
+        }
+        std::latch ready(static_cast<std::ptrdiff_t>(workers.size()));
+        for (auto& worker : workers) {
+            worker->thread = std::thread([this, &worker = *worker, &ready, scratchBytes] {
+                workerThread(worker, scratchBytes, ready);
+            });
+        }
+        ready.wait();
+    }
+
+    ThreadPerCorePool(const ThreadPerCorePool&) = delete;
+    ThreadPerCorePool& operator=(const ThreadPerCorePool&) = delete;
+
+    ~ThreadPerCorePool() {
+        stopping.store(true, std::memory_order_release);
+        for (auto& worker : workers) {
+            worker->wait.notify();
+        }
+        for (auto& worker : workers) {
+            worker->thread.join();
+        }
+    }
+
+    /// Any thread; runs `function` on the worker that owns `key`.
+    template <typename Key, typename F>
+    void submit(const Key& key, F&& function) {
+        submitTo(workerFor(key), std::forward<F>(function));
+    }
+
+    /// Any thread; yields while that worker's queue is full.
+    template <typename F>
+    void submitTo(size_t index, F&& function) {
+        Worker& worker = *workers[index];
+        Job job(std::forward<F>(function));
+        while (!worker.tasks->enqueue(std::move(job))) {
+            std::this_thread::yield();
+        }
+        worker.wait.notify_one();
+    }
+
+    /// Any thread; like `submit`, and returns a Future for the result.
+    template <typename Key, typename F>
+    auto async(const Key& key, F&& function) {
+        auto [task, future] = withFuture(std::forward<F>(function));
+        submitTo(workerFor(key), std::move(task));
+        return std::move(future);
+    }
+
+    template <typename Key>
+    size_t workerFor(const Key& key) const {
+        return std::hash<Key>{}(key) % workers.size();
+    }
+
+    size_t threads() const { return workers.size(); }
+
+    int cpu(size_t index) const { return workers[index]->cpu; }
+
+    /// NUMA node the worker's CPU belongs to, as the kernel reported it.
+    int node(size_t index) const { return workers[index]->node; }
+
+    /// The calling worker's scratch memory, node-local and only ever used
+    /// by that worker; empty on any other thread.
+    static std::span<std::byte> scratch() { return current; }
+
+private:
+    using Queue = MpscQueue<Job, Capacity>;
+
+    struct alignas(CacheLineSize) Worker {
+        std::unique_ptr<Queue> tasks;
+        std::unique_ptr<std::byte[]> scratch;
+        SpinThenPark<> wait;
+        int cpu = -1;
+        int node = -1;
+        std::thread thread;
+    };
+
+    inline static thread_local std::span<std::byte> current;
+
+    void workerThread(Worker& worker, size_t scratchBytes, std::latch& ready) {
+        pinToCpu(worker.cpu);
+        // Undo any interleave policy inherited from numactl; failing is
+        // harmless, as the default policy is local too.
+        syscall(SYS_set_mempolicy, MPOL_LOCAL, nullptr, 0);
+        unsigned cpu = 0;
+        unsigned node = 0;
+        if (getcpu(&cpu, &node) == 0) {
+            worker.node = static_cast<int>(node);
+        }
+        // The queue's constructor writes every slot, which faults its pages
+        // in here; the scratch buffer is touched by hand.
+        worker.tasks = std::make_unique<Queue>();
+        worker.scratch = std::make_unique_for_overwrite<std::byte[]>(scratchBytes);
+        std::memset(worker.scratch.get(), 0, scratchBytes);
+        current = {worker.scratch.get(), scratchBytes};
+        ready.count_down();
+
+        Job job;
+        for (;;) {
+            worker.wait.wait([&] {
+                return worker.tasks->dequeue(job) || stopping.load(std::memory_order_acquire);
+            });
+            if (!job) {
+                break; // Stopping, and the queue looked empty
+            }
+            job();
+            job = Job();
+        }
+        // Tasks submitted before the destructor ran, seen after `stopping`.
+        while (worker.tasks->dequeue(job)) {
+            job();
+        }
+        current = {};
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<bool> stopping{false};
+};
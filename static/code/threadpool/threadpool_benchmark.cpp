@@ -0,0 +1,330 @@
+// Build: g++ -std=c++20 -O2 -march=native -pthread threadpool_benchmark.cpp -o threadpool_benchmark
+// Usage: threadpool_benchmark [workers]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "lock_free_thread_pool.h"
+
+/**
+ * Task throughput of LockFreeThreadPool against the mutex + condition
+ * variable ThreadPool of basic_threadpool.md (kept below as it is there).
+ *
+ * Each task captures 32 bytes, as a task carrying a few pointers and ids
+ * does, and bumps a counter; the run ends when every task has run. Tasks
+ * are submitted from one thread, then from as many threads as there are
+ * workers. The table shows tasks per second, and heap allocations per task
+ * counted by a replaced operator new.
+ *
+ * A second table returns each task's result through a future: the
+ * packaged_task `submit` of threadPool_with_future_and_promise.md (also
+ * kept below) against `LockFreeThreadPool::async`. One thread submits
+ * `Window` tasks at a time and then waits for all of their results, as a
+ * caller fanning out requests does. A last row drops each future at once,
+ * so the worker always releases the shared state last: its block must
+ * still go back to the submitter's pool, or the submitter allocates for
+ * every task while the workers' free lists grow.
+ *
+ * Last, a wakeup check: the pool is left idle until every worker has
+ * parked, then gets a burst of far more tasks than workers, and every task
+ * must run within `BurstDeadlineMs`. A wakeup lost on the way from idle to
+ * busy shows up here as tasks stranded in the queue.
+ */
+
+std::atomic<uint64_t> allocations{0};
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+
+namespace baseline {
+
+class ThreadPool {
+public:
+    ThreadPool(size_t numThreads) : stop(false) {
+        for (size_t i = 0; i < numThreads; ++i) {
+            workers.emplace_back([this] { workerThread(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            stop = true;
+        }
+        condition.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    void enqueueTask(std::function<void()> task) {
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            tasks.push(std::move(task));
+        }
+        condition.notify_one();
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+
+    std::mutex queueMutex;
+    std::condition_variable condition;
+    bool stop;
+
+    void workerThread() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                condition.wait(lock, [this] { return stop || !tasks.empty(); });
+
+                if (stop && tasks.empty())
+                    return;
+
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+};
+
+class FutureThreadPool {
+public:
+    explicit FutureThreadPool(size_t numThreads);
+    ~FutureThreadPool();
+
+    template<typename F, typename... Args>
+    auto submit(F&& f, Args&&... args) -> std::future<decltype(f(args...))>;
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex queueMutex;
+    std::condition_variable condition;
+    bool stop;
+};
+
+FutureThreadPool::FutureThreadPool(size_t numThreads) : stop(false) {
+    for (size_t i = 0; i < numThreads; ++i) {
+        workers.emplace_back([this] {
+            while (true) {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(queueMutex);
+                    condition.wait(lock, [this] { return stop || !tasks.empty(); });
+                    if (stop && tasks.empty()) return;
+                    task = std::move(tasks.front());
+                    tasks.pop();
+                }
+                task();
+            }
+        });
+    }
+}
+
+FutureThreadPool::~FutureThreadPool() {
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        stop = true;
+    }
+    condition.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+template<typename F, typename... Args>
+auto FutureThreadPool::submit(F&& f, Args&&... args) -> std::future<decltype(f(args...))> {
+    using ReturnType = decltype(f(args...));
+    auto task = std::make_shared<std::packaged_task<ReturnType()>>(
+        std::bind(std::forward<F>(f), std::forward<Args>(args)...)
+    );
+    std::future<ReturnType> future = task->get_future();
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        if (stop) throw std::runtime_error("ThreadPool is stopped");
+        tasks.emplace([task]() { (*task)(); });
+    }
+    condition.notify_one();
+    return future;
+}
+
+} // namespace baseline
+
+constexpr uint64_t Tasks = 1'000'000;
+
+struct Result {
+    double tasksPerSecond;
+    double allocationsPerTask;
+};
+
+/// Submits `Tasks` tasks from `submitters` threads through `submit`.
+template <typename Submit>
+Result run(size_t submitters, Submit submit) {
+    std::atomic<uint64_t> done{0};
+    uint64_t before = allocations.load();
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (size_t s = 0; s < submitters; ++s) {
+        threads.emplace_back([&, s] {
+            uint64_t weight = s + 1;
+            for (uint64_t i = s; i < Tasks; i += submitters) {
+                submit([&done, i, weight, id = i * 7] {
+                    if (i + weight + id != 0) {
+                        done.fetch_add(1, std::memory_order_relaxed);
+                    }
+                });
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    while (done.load(std::memory_order_relaxed) != Tasks) {
+        std::this_thread::yield();
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    // Thread creation allocates too; at one per submitter it rounds away.
+    return {Tasks / elapsed.count(),
+            static_cast<double>(allocations.load() - before) / Tasks};
+}
+
+constexpr size_t Window = 256;
+
+/// Submits `Tasks` tasks through `submit`, which returns a future of the
+/// task's result, `Window` at a time, and checks every result.
+template <typename Future, typename Submit>
+Result runWithFutures(Submit submit) {
+    std::vector<Future> futures(Window);
+    uint64_t before = allocations.load();
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint64_t first = 0; first < Tasks; first += Window) {
+        for (size_t i = 0; i < Window; ++i) {
+            futures[i] = submit([id = first + i, weight = uint64_t{3}] { return id * weight; });
+        }
+        for (size_t i = 0; i < Window; ++i) {
+            if (futures[i].get() != (first + i) * 3) {
+                std::fprintf(stderr, "wrong result for task %llu\n",
+                             static_cast<unsigned long long>(first + i));
+                std::exit(1);
+            }
+        }
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return {Tasks / elapsed.count(),
+            static_cast<double>(allocations.load() - before) / Tasks};
+}
+
+constexpr int IdleBursts = 50;
+constexpr size_t BurstTasks = 1000;
+constexpr int BurstDeadlineMs = 2'000;
+
+/// Runs `IdleBursts` bursts of `BurstTasks` tasks through a pool that is
+/// idle before each; false if a burst missed the deadline.
+bool idleBursts(size_t workers) {
+    LockFreeThreadPool<> pool(workers);
+    std::atomic<uint64_t> done{0};
+    uint64_t sent = 0;
+    for (int burst = 0; burst < IdleBursts; ++burst) {
+        // Well past the workers' spin phase, so they are all asleep.
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        for (size_t i = 0; i < BurstTasks; ++i) {
+            pool.submit([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+        }
+        sent += BurstTasks;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(BurstDeadlineMs);
+        while (done.load(std::memory_order_relaxed) != sent) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                std::printf("burst %d: %llu of %llu tasks ran within %d ms: STRANDED\n", burst,
+                            static_cast<unsigned long long>(done.load()),
+                            static_cast<unsigned long long>(sent), BurstDeadlineMs);
+                return false;
+            }
+            std::this_thread::yield();
+        }
+    }
+    std::printf("\n%d bursts of %zu tasks into an idle pool: all ran within %d ms\n", IdleBursts,
+                BurstTasks, BurstDeadlineMs);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    size_t workers = argc > 1 ? std::strtoul(argv[1], nullptr, 10)
+                              : std::max(2u, std::thread::hardware_concurrency());
+    std::printf("%u hardware threads, %zu workers, %llu tasks per run:\n",
+                std::thread::hardware_concurrency(), workers,
+                static_cast<unsigned long long>(Tasks));
+    std::printf("%-26s %12s %12s %16s\n", "pool", "submitters", "M tasks/s", "mallocs/task");
+
+    for (size_t submitters : {size_t{1}, workers}) {
+        Result locked;
+        {
+            baseline::ThreadPool pool(workers);
+            locked = run(submitters, [&](auto task) { pool.enqueueTask(std::move(task)); });
+        }
+        Result lockFree;
+        {
+            LockFreeThreadPool<> pool(workers);
+            lockFree = run(submitters, [&](auto task) { pool.submit(std::move(task)); });
+        }
+        std::printf("%-26s %12zu %12.2f %16.2f\n", "mutex + condvar", submitters,
+                    locked.tasksPerSecond / 1e6, locked.allocationsPerTask);
+        std::printf("%-26s %12zu %12.2f %16.2f\n", "lock-free ring + park", submitters,
+                    lockFree.tasksPerSecond / 1e6, lockFree.allocationsPerTask);
+    }
+
+    std::printf("\nwith a future per task, one submitter, %zu in flight:\n", Window);
+    std::printf("%-26s %12s %16s\n", "pool", "M tasks/s", "mallocs/task");
+    Result packaged;
+    {
+        baseline::FutureThreadPool pool(workers);
+        packaged = runWithFutures<std::future<uint64_t>>(
+            [&](auto task) { return pool.submit(std::move(task)); });
+    }
+    Result pooled;
+    {
+        LockFreeThreadPool<> pool(workers);
+        pooled = runWithFutures<Future<uint64_t>>(
+            [&](auto task) { return pool.async(std::move(task)); });
+    }
+    std::printf("%-26s %12.2f %16.2f\n", "packaged_task + std::future", packaged.tasksPerSecond / 1e6,
+                packaged.allocationsPerTask);
+    Result dropped;
+    {
+        LockFreeThreadPool<> pool(workers);
+        dropped = run(1, [&](auto task) { pool.async(std::move(task)); });
+    }
+    std::printf("%-26s %12.2f %16.2f\n", "async + pooled Future", pooled.tasksPerSecond / 1e6,
+                pooled.allocationsPerTask);
+    std::printf("%-26s %12.2f %16.2f\n", "async, future dropped", dropped.tasksPerSecond / 1e6,
+                dropped.allocationsPerTask);
+    return idleBursts(workers) ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "../lockfree/queue.h"
+
+/**
+ * Chase-Lev work-stealing deque, with the C11 memory orders of Lê, Pop,
+ * Cohen and Zappa Nardelli, "Correct and Efficient Work-Stealing for Weak
+ * Memory Models" (PPoPP 2013).
+ *
+ * - One owner thread pushes and pops at the bottom: `push` has no fence and
+ *   no RMW, just a release store bumping `bottom`; `pop` needs one full
+ *   fence (to order its `bottom` store against a thief's `top` read), and a
+ *   CAS only when it takes the last item, the one case where it can race a
+ *   thief. So the owner's LIFO fast path never serializes with thieves.
+ * - Any thread steals from the top with one CAS on `top`; a thief that
+ *   loses the race gets nothing and moves on to another victim.
+ * - The ring is a power of two and doubles when full. Thieves may still be
+ *   reading an old ring, so it is retired, not freed, until the deque is
+ *   destroyed; the rings retired along the way add up to less than the
+ *   final one.
+ *
+ * Items are read by a thief before its CAS decides whether it owns them,
+ * so T is a pointer-sized trivially copyable value (a task pointer, an
+ * index) held in atomics.
+ */
+template <typename T>
+class ChaseLevDeque {
+    static_assert(std::is_trivially_copyable_v<T> && sizeof(T) <= sizeof(uint64_t));
+    static_assert(std::atomic<T>::is_always_lock_free);
+
+public:
+    explicit ChaseLevDeque(size_t initialCapacity = 256) {
+        size_t capacity = 2;
+        while (capacity < initialCapacity) {
+            capacity *= 2;
+        }
+        rings.push_back(std::make_unique<Ring>(capacity));
+        ring.store(rings.back().get(), std::memory_order_relaxed);
+    }
+
+    ChaseLevDeque(const ChaseLevDeque&) = delete;
+    ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+    /// Owner only.
+    void push(T item) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        Ring* current = ring.load(std::memory_order_relaxed);
+        if (b - t > static_cast<int64_t>(current->mask)) {
+            current = grow(current, t, b);
+        }
+        current->put(b, item);
+        bottom.store(b + 1, std::memory_order_release);
+    }
+
+    /// Owner only: the most recently pushed item, if any.
+    bool pop(T& item) {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Ring* current = ring.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed); // Empty
+            return false;
+        }
+        item = current->get(b);
+        if (t == b) {
+            // The last item: a thief may be taking it too.
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                   std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    /// Any thread: the oldest item, if any and if no one else takes it first.
+    bool steal(T& item) {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return false; // Empty
+        }
+        // Acquire pairs with the release in `grow`, so a new ring is seen
+        // with its contents.
+        Ring* current = ring.load(std::memory_order_acquire);
+        item = current->get(t);
+        return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                           std::memory_order_relaxed);
+    }
+
+    /// Snapshot; exact only when no one else is using the deque.
+    size_t size() const {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_relaxed);
+        return b > t ? static_cast<size_t>(b - t) : 0;
+    }
+
+private:
+    struct Ring {
+        explicit Ring(size_t capacity) : mask(capacity - 1), items(new std::atomic<T>[capacity]) {}
+
+        T get(int64_t index) const { return items[index & mask].load(std::memory_order_relaxed); }
+        void put(int64_t index, T item) { items[index & mask].store(item, std::memory_order_relaxed); }
+
+        size_t mask;
+        std::unique_ptr<std::atomic<T>[]> items;
+    };
+
+    /// Owner only: doubles the ring, keeping the old one for late thieves.
+    Ring* grow(Ring* old, int64_t t, int64_t b) {
+        rings.push_back(std::make_unique<Ring>(2 * (old->mask + 1)));
+        Ring* bigger = rings.back().get();
+        for (int64_t i = t; i < b; ++i) {
+            bigger->put(i, old->get(i));
+        }
+        ring.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+    // Thieves' line.
+    alignas(CacheLineSize) std::atomic<int64_t> top{0};
+
+    // Owner's line.
+    alignas(CacheLineSize) std::atomic<int64_t> bottom{0};
+    std::vector<std::unique_ptr<Ring>> rings; // the current one and every retired one
+    std::atomic<Ring*> ring{nullptr};
+};
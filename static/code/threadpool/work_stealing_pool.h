@@ -0,0 +1,190 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../lockfree/mpmc_queue.h"
+#include "../lockfree/wait_strategy.h"
+#include "future.h"
+#include "task.h"
+#include "thread_local_pool.h"
+#include "work_stealing_deque.h"
+
+/**
+ * Work-stealing thread pool for fork-join work.
+ *
+ * - Each worker owns a ChaseLevDeque. A task submitted from a worker goes
+ *   on that worker's deque and the worker runs its newest task first
+ *   (LIFO), which keeps a recursive split depth-first and cache-warm. Its
+ *   pushes and pops take no lock and, except for the last item, no RMW.
+ * - A worker with nothing of its own takes tasks submitted from outside
+ *   the pool (an MpmcQueue), then steals the oldest task (the biggest
+ *   piece of a recursive split) from other workers. Victims are tried
+ *   starting at a random one, so idle workers spread over the busy ones
+ *   instead of all hitting worker 0.
+ * - `helpUntil(done)` runs tasks until `done()` holds, so a task can fork
+ *   children and join them without blocking its worker.
+ * - Idle workers spin, then park (SpinThenPark); a submit wakes one.
+ * - Tasks are InplaceTask<> nodes recycled through a ThreadLocalPool, so a
+ *   steady fork-join computation does not touch the allocator; `async`
+ *   returns a Future whose state is pooled the same way.
+ * The destructor runs every task already submitted, then joins.
+ */
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(size_t threads) : injected(std::make_unique<Injected>()) {
+        for (size_t i = 0; i < threads; ++i) {
+            workers.push_back(std::make_unique<Worker>());
+            workers.back()->rng = 0x9e3779b97f4a7c15ull * (i + 1);
+        }
+        for (size_t i = 0; i < threads; ++i) {
+            workers[i]->thread = std::thread([this, i] { workerThread(i); });
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    ~WorkStealingPool() {
+        stopping.store(true, std::memory_order_release);
+        wait.notify();
+        for (auto& worker : workers) {
+            worker->thread.join();
+        }
+    }
+
+    /// Any thread. From one of this pool's workers the task goes on its own
+    /// deque, otherwise on the shared queue (yielding while that is full).
+    template <typename F>
+    void submit(F&& function) {
+        Node* node = ThreadLocalPool<Node>::create(std::forward<F>(function));
+        if (current.pool == this) {
+            workers[current.index]->deque.push(node);
+        } else {
+            while (!injected->enqueue(node)) {
+                std::this_thread::yield();
+            }
+        }
+        wait.notify_one();
+    }
+
+    /// Any thread; like `submit`, and returns a Future for the result.
+    template <typename F>
+    auto async(F&& function) {
+        auto [task, future] = withFuture(std::forward<F>(function));
+        submit(std::move(task));
+        return std::move(future);
+    }
+
+    /**
+     * Runs tasks until `done()` is true. On a worker this is how a task
+     * joins its children; any other thread may call it too, and then steals
+     * like an idle worker.
+     */
+    template <typename Done>
+    void helpUntil(Done done) {
+        while (!done()) {
+            if (Node* node = findWork()) {
+                run(node);
+            } else {
+                cpuRelax();
+            }
+        }
+    }
+
+    size_t threads() const { return workers.size(); }
+
+    /// Tasks taken from another worker's deque, over the pool's lifetime.
+    uint64_t steals() const { return steals_.load(std::memory_order_relaxed); }
+
+private:
+    /// Nodes go back to the pool of the thread that created them, even when
+    /// another worker stole and ran them.
+    struct Node {
+        template <typename F>
+        explicit Node(F&& function) : task(std::forward<F>(function)) {}
+
+        InplaceTask<> task;
+    };
+
+    struct alignas(CacheLineSize) Worker {
+        ChaseLevDeque<Node*> deque;
+        uint64_t rng = 0;
+        std::thread thread;
+    };
+
+    /// Which pool and worker the calling thread is, if any (zero-initialized
+    /// as a thread_local: no pool).
+    struct Identity {
+        WorkStealingPool* pool;
+        size_t index;
+    };
+
+    using Injected = MpmcQueue<Node*, 4096>;
+
+    inline static thread_local Identity current;
+
+    static void run(Node* node) {
+        node->task();
+        ThreadLocalPool<Node>::destroy(node);
+    }
+
+    Node* findWork() {
+        Node* node = nullptr;
+        Worker* self = current.pool == this ? workers[current.index].get() : nullptr;
+        if (self != nullptr && self->deque.pop(node)) {
+            return node;
+        }
+        if (injected->dequeue(node)) {
+            return node;
+        }
+        size_t count = workers.size();
+        size_t start = self != nullptr ? nextRandom(self->rng) % count : 0;
+        for (size_t i = 0; i < count; ++i) {
+            Worker* victim = workers[(start + i) % count].get();
+            if (victim != self && victim->deque.steal(node)) {
+                steals_.fetch_add(1, std::memory_order_relaxed);
+                return node;
+            }
+        }
+        return nullptr;
+    }
+
+    static uint64_t nextRandom(uint64_t& state) {
+        // xorshift64
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    void workerThread(size_t index) {
+        current = {this, index};
+        Node* node = nullptr;
+        for (;;) {
+            wait.wait([&] {
+                return (node = findWork()) != nullptr || stopping.load(std::memory_order_acquire);
+            });
+            if (node == nullptr) {
+                break; // Stopping, and no work was found
+            }
+            run(node);
+        }
+        // Tasks submitted before the destructor ran, seen after `stopping`.
+        while ((node = findWork()) != nullptr) {
+            run(node);
+        }
+        current = Identity{nullptr, 0};
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::unique_ptr<Injected> injected;
+    SpinThenPark<> wait;
+    std::atomic<bool> stopping{false};
+    std::atomic<uint64_t> steals_{0};
+};